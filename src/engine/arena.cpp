@@ -0,0 +1,40 @@
+#include "arena.h"
+
+alignas(8) static uint8_t arena[ARENA_SIZE];
+static size_t arenaTop = 0;
+static size_t arenaHigh = 0;
+
+void *arenaAlloc(size_t size, size_t align) {
+    size_t start = (arenaTop + align - 1) & ~(align - 1);
+    if (start + size > ARENA_SIZE) {
+        Serial.printf("Arena: %u bytes requested with %u of %u in use\n",
+                      (unsigned)size, (unsigned)arenaTop, (unsigned)ARENA_SIZE);
+        abort();
+    }
+
+    arenaTop = start + size;
+    arenaHigh = max(arenaHigh, arenaTop);
+    memset(arena + start, 0, size);
+    return arena + start;
+}
+
+void arenaReset() {
+    arenaTop = 0;
+    arenaHigh = 0;
+}
+
+size_t arenaMark() {
+    return arenaTop;
+}
+
+void arenaRelease(size_t mark) {
+    if (mark < arenaTop) arenaTop = mark;
+}
+
+size_t arenaUsed() {
+    return arenaTop;
+}
+
+size_t arenaPeak() {
+    return arenaHigh;
+}
@@ -0,0 +1,43 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <M5Stack.h>
+#include <new>
+
+// One bump arena shared by the games. Only one game runs at a time, so a
+// game carves its bulky state out of the arena in setup and main resets
+// the whole arena when play returns to the menu. DRAM then holds the
+// largest game's state rather than every game's at once.
+//
+// Memory is zeroed when handed out. Running out is a bug in ARENA_SIZE,
+// not something a game can recover from, so it aborts with a message.
+
+#define ARENA_SIZE (40 * 1024)
+
+void *arenaAlloc(size_t size, size_t align);
+
+// Forget everything handed out since the last reset
+void arenaReset();
+
+// Scratch space: allocate after taking a mark, then release back to it
+size_t arenaMark();
+void arenaRelease(size_t mark);
+
+size_t arenaUsed();
+
+// High-water mark since the last reset
+size_t arenaPeak();
+
+// count zeroed Ts, for plain data; T may itself be an array type
+template <typename T>
+T *arenaArray(size_t count) {
+    return static_cast<T *>(arenaAlloc(sizeof(T) * count, alignof(T)));
+}
+
+// One T, constructed in place
+template <typename T>
+T *arenaNew() {
+    return new (arenaAlloc(sizeof(T), alignof(T))) T();
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef DEBUG_STATS_H
+#define DEBUG_STATS_H
+
+// Profiling on Serial: each game's arena, display list, bus, quality and
+// font figures on the way back to the menu, and quality level changes as
+// they happen.
+// Errors are reported either way.
+
+#define DEBUG_STATS 0
+
+#endif
@@ -0,0 +1,578 @@
+#include "display_list.h"
+#include "lcd_batch.h"
+#include "screen_capture.h"
+#include "raster.h"
+
+#define GLYPH_WIDTH 6          // Built-in font cell at text size 1
+#define GLYPH_HEIGHT 8
+
+// Visible run of one item on the scanline being resolved
+struct RowSegment {
+    int16_t x0, x1;
+    uint16_t item;
+};
+
+static DisplayTotals totals;
+
+static void setBounds(DisplayItem &item, int minX, int minY, int maxX, int maxY) {
+    item.minX = minX;
+    item.minY = minY;
+    item.maxX = maxX;
+    item.maxY = maxY;
+}
+
+// Screen extent lo..lo+len-1 snapped to the list's grid
+static void snap(const DisplayList &list, int &lo, int &len) {
+    int hi = (lo + len - 1) >> list.shift;
+    lo >>= list.shift;
+    len = hi - lo + 1;
+}
+
+static DisplayItem *newItem(DisplayList &list, DisplayItemKind kind, uint16_t color) {
+    if (list.count == MAX_DISPLAY_ITEMS) {
+        list.dropped++;
+        return NULL;
+    }
+    DisplayItem *item = &list.items[list.count++];
+    memset(item, 0, sizeof(*item));
+    item->kind = kind;
+    item->color = color;
+    return item;
+}
+
+void recordFillRect(DisplayList &list, int x, int y, int w, int h, uint16_t color) {
+    if (w <= 0 || h <= 0) return;
+    snap(list, x, w);
+    snap(list, y, h);
+
+    // Grow the previous fill when this one continues it edge to edge
+    if (list.count > 0) {
+        DisplayItem &last = list.items[list.count - 1];
+        if (last.kind == ITEM_FILL_RECT && last.color == color) {
+            if (last.minY == y && last.maxY == y + h - 1) {
+                if (last.maxX + 1 == x) { last.maxX = x + w - 1; return; }
+                if (x + w == last.minX) { last.minX = x; return; }
+            }
+            if (last.minX == x && last.maxX == x + w - 1) {
+                if (last.maxY + 1 == y) { last.maxY = y + h - 1; return; }
+                if (y + h == last.minY) { last.minY = y; return; }
+            }
+        }
+    }
+
+    DisplayItem *item = newItem(list, ITEM_FILL_RECT, color);
+    if (item) setBounds(*item, x, y, x + w - 1, y + h - 1);
+}
+
+void recordRect(DisplayList &list, int x, int y, int w, int h, uint16_t color) {
+    if (w <= 0 || h <= 0) return;
+    snap(list, x, w);
+    snap(list, y, h);
+    DisplayItem *item = newItem(list, ITEM_RECT, color);
+    if (item) setBounds(*item, x, y, x + w - 1, y + h - 1);
+}
+
+static void recordCircleItem(DisplayList &list, DisplayItemKind kind, int x, int y, int r,
+                             uint16_t color) {
+    if (r < 0) return;
+    DisplayItem *item = newItem(list, kind, color);
+    if (!item) return;
+    x >>= list.shift;
+    y >>= list.shift;
+    r >>= list.shift;
+    item->x0 = x;
+    item->y0 = y;
+    item->x1 = r;
+    setBounds(*item, x - r, y - r, x + r, y + r);
+}
+
+void recordFillCircle(DisplayList &list, int x, int y, int r, uint16_t color) {
+    recordCircleItem(list, ITEM_FILL_CIRCLE, x, y, r, color);
+}
+
+void recordCircle(DisplayList &list, int x, int y, int r, uint16_t color) {
+    recordCircleItem(list, ITEM_CIRCLE, x, y, r, color);
+}
+
+void recordLine(DisplayList &list, int x0, int y0, int x1, int y1, uint16_t color) {
+    DisplayItem *item = newItem(list, ITEM_LINE, color);
+    if (!item) return;
+    x0 >>= list.shift; y0 >>= list.shift;
+    x1 >>= list.shift; y1 >>= list.shift;
+
+    // Top end first
+    if (y1 < y0) {
+        int tx = x0, ty = y0;
+        x0 = x1; y0 = y1;
+        x1 = tx; y1 = ty;
+    }
+    item->x0 = x0;
+    item->y0 = y0;
+    item->x1 = x1;
+    item->y1 = y1;
+    setBounds(*item, min(x0, x1), y0, max(x0, x1), y1);
+}
+
+void recordFillTriangle(DisplayList &list, int x0, int y0, int x1, int y1,
+                        int x2, int y2, uint16_t color) {
+    DisplayItem *item = newItem(list, ITEM_FILL_TRIANGLE, color);
+    if (!item) return;
+    x0 >>= list.shift; y0 >>= list.shift;
+    x1 >>= list.shift; y1 >>= list.shift;
+    x2 >>= list.shift; y2 >>= list.shift;
+
+    // Sort vertices top to bottom
+    if (y1 < y0) { int t = x0; x0 = x1; x1 = t; t = y0; y0 = y1; y1 = t; }
+    if (y2 < y1) { int t = x1; x1 = x2; x2 = t; t = y1; y1 = y2; y2 = t; }
+    if (y1 < y0) { int t = x0; x0 = x1; x1 = t; t = y0; y0 = y1; y1 = t; }
+
+    item->x0 = x0; item->y0 = y0;
+    item->x1 = x1; item->y1 = y1;
+    item->x2 = x2; item->y2 = y2;
+    setBounds(*item, min(x0, min(x1, x2)), y0, max(x0, max(x1, x2)), y2);
+}
+
+static void recordTextItem(DisplayList &list, int x, int y, const char *text, int size,
+                           uint16_t color, uint16_t background, bool opaque) {
+    int len = strlen(text);
+    if (len == 0 || size < 1) return;
+    if (list.textUsed + len + 1 > DISPLAY_TEXT_POOL) {
+        list.dropped++;
+        return;
+    }
+
+    DisplayItem *item = newItem(list, ITEM_TEXT, color);
+    if (!item) return;
+
+    char *copy = list.text + list.textUsed;
+    memcpy(copy, text, len + 1);
+    list.textUsed += len + 1;
+
+    item->size = size;
+    item->opaque = opaque;
+    item->background = background;
+    // Drawn at full resolution from the screen position, whatever the grid
+    item->x0 = x;
+    item->y0 = y;
+    item->data = copy;
+    int s = list.shift;
+    setBounds(*item, x >> s, y >> s, (x + len * GLYPH_WIDTH * size - 1) >> s,
+              (y + GLYPH_HEIGHT * size - 1) >> s);
+}
+
+void recordText(DisplayList &list, int x, int y, const char *text, int size, uint16_t color) {
+    recordTextItem(list, x, y, text, size, color, color, false);
+}
+
+void recordText(DisplayList &list, int x, int y, const char *text, int size,
+                uint16_t color, uint16_t background) {
+    recordTextItem(list, x, y, text, size, color, background, true);
+}
+
+void recordImage(DisplayList &list, int x, int y, int w, int h, const uint16_t *pixels) {
+    if (w <= 0 || h <= 0) return;
+    DisplayItem *item = newItem(list, ITEM_IMAGE, 0);
+    if (!item) return;
+    // Screen position and row length, for sampling from the grid
+    item->x0 = x;
+    item->y0 = y;
+    item->x1 = w;
+    item->size = list.shift;
+    item->data = pixels;
+    int s = list.shift;
+    setBounds(*item, x >> s, y >> s, (x + w - 1) >> s, (y + h - 1) >> s);
+}
+
+void initDisplayFrame(DisplayFrame &frame, int x, int y, int w, int h) {
+    frame.lists[0].count = 0;
+    frame.lists[0].textUsed = 0;
+    frame.lists[1].count = 0;
+    frame.lists[1].textUsed = 0;
+    frame.current = 0;
+    frame.fullRedraw = true;
+    frame.shift = 0;
+    frame.clipX = max(x, 0);
+    frame.clipY = max(y, 0);
+    frame.clipW = min(x + w, DISPLAY_WIDTH) - frame.clipX;
+    frame.clipH = min(y + h, DISPLAY_HEIGHT) - frame.clipY;
+    memset(&frame.stats, 0, sizeof(frame.stats));
+}
+
+DisplayList &beginDisplayFrame(DisplayFrame &frame) {
+    DisplayList &list = frame.lists[frame.current];
+    list.count = 0;
+    list.textUsed = 0;
+    list.dropped = 0;
+    list.shift = frame.shift;
+    return list;
+}
+
+void invalidateDisplayFrame(DisplayFrame &frame) {
+    frame.fullRedraw = true;
+}
+
+void setDisplayFrameHalfRes(DisplayFrame &frame, bool half) {
+    if (frame.shift == (half ? 1 : 0)) return;
+    frame.shift = half ? 1 : 0;
+    frame.fullRedraw = true;
+}
+
+// The clip rect on the frame's grid, inclusive
+static void gridClip(const DisplayFrame &frame, int &x0, int &y0, int &x1, int &y1) {
+    x0 = frame.clipX >> frame.shift;
+    y0 = frame.clipY >> frame.shift;
+    x1 = (frame.clipX + frame.clipW - 1) >> frame.shift;
+    y1 = (frame.clipY + frame.clipH - 1) >> frame.shift;
+}
+
+// Pixels of a line on row y: one per row when steep, a run when shallow
+static void lineSpan(const DisplayItem &item, int y, int &a, int &b) {
+    int dx = item.x1 - item.x0;
+    int dy = item.y1 - item.y0;
+    int adx = abs(dx);
+    int sx = dx < 0 ? -1 : 1;
+    int j = y - item.y0;
+
+    if (dy == 0) {
+        a = item.minX;
+        b = item.maxX;
+    } else if (adx <= dy) {
+        a = b = item.x0 + sx * divRound(j * adx, dy);
+    } else {
+        // Steps k along x whose rounded y lands on this row
+        int kStart = max(divCeil((2 * j - 1) * adx, 2 * dy), 0);
+        int kEnd = min(divCeil((2 * j + 1) * adx, 2 * dy) - 1, adx);
+        a = item.x0 + sx * kStart;
+        b = item.x0 + sx * kEnd;
+        if (a > b) { int t = a; a = b; b = t; }
+    }
+}
+
+// Up to two runs an item covers on row y, returned as pairs in spans
+static int itemSpans(const DisplayItem &item, int y, int spans[4]) {
+    switch (item.kind) {
+        case ITEM_FILL_RECT:
+        case ITEM_TEXT:
+        case ITEM_IMAGE:
+            spans[0] = item.minX;
+            spans[1] = item.maxX;
+            return 1;
+
+        case ITEM_RECT:
+            spans[0] = item.minX;
+            if (y == item.minY || y == item.maxY || item.maxX - item.minX < 2) {
+                spans[1] = item.maxX;
+                return 1;
+            }
+            spans[1] = item.minX;
+            spans[2] = item.maxX;
+            spans[3] = item.maxX;
+            return 2;
+
+        case ITEM_FILL_CIRCLE: {
+            int hw = circleHalfWidth(item.x1, y - item.y0);
+            spans[0] = item.x0 - hw;
+            spans[1] = item.x0 + hw;
+            return 1;
+        }
+
+        case ITEM_CIRCLE: {
+            int outer = circleHalfWidth(item.x1, y - item.y0);
+            int inner = circleHalfWidth(item.x1 - 1, y - item.y0);
+            spans[0] = item.x0 - outer;
+            if (inner < 0) {
+                spans[1] = item.x0 + outer;
+                return 1;
+            }
+            spans[1] = item.x0 - inner - 1;
+            spans[2] = item.x0 + inner + 1;
+            spans[3] = item.x0 + outer;
+            return 2;
+        }
+
+        case ITEM_LINE:
+            lineSpan(item, y, spans[0], spans[1]);
+            return 1;
+
+        case ITEM_FILL_TRIANGLE: {
+            const int16_t xs[3] = {item.x0, item.x1, item.x2};
+            const int16_t ys[3] = {item.y0, item.y1, item.y2};
+            return polygonSpan(xs, ys, 3, y, spans[0], spans[1]) ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
+static bool sameItem(const DisplayItem &a, const DisplayItem &b) {
+    if (memcmp(&a, &b, offsetof(DisplayItem, data)) != 0) return false;
+    if (a.kind == ITEM_TEXT) return strcmp((const char *)a.data, (const char *)b.data) == 0;
+    return a.data == b.data;
+}
+
+static void markDirty(DisplayFrame &frame, const DisplayItem &item) {
+    int x0, y0, x1, y1;
+    gridClip(frame, x0, y0, x1, y1);
+    x0 = max((int)item.minX, x0);
+    y0 = max((int)item.minY, y0);
+    x1 = min((int)item.maxX, x1);
+    y1 = min((int)item.maxY, y1);
+    if (x0 > x1 || y0 > y1) return;
+
+    int c0 = x0 / DIRTY_CELL;
+    int c1 = x1 / DIRTY_CELL;
+    uint64_t cells = (c1 - c0 == 63 ? ~0ULL : ((2ULL << (c1 - c0)) - 1)) << c0;
+    for (int row = y0 / DIRTY_CELL; row <= y1 / DIRTY_CELL; row++) {
+        frame.dirty[row] |= cells;
+    }
+}
+
+static void findDirtyCells(DisplayFrame &frame) {
+    const DisplayList &curr = frame.lists[frame.current];
+    const DisplayList &prev = frame.lists[frame.current ^ 1];
+    memset(frame.dirty, 0, sizeof(frame.dirty));
+
+    if (frame.fullRedraw) {
+        DisplayItem all;
+        setBounds(all, 0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1);
+        markDirty(frame, all);
+        return;
+    }
+
+    // Anything that differs by position in the list repaints where it
+    // was and where it is now
+    int count = max(curr.count, prev.count);
+    for (int i = 0; i < count; i++) {
+        if (i >= curr.count) {
+            markDirty(frame, prev.items[i]);
+        } else if (i >= prev.count) {
+            markDirty(frame, curr.items[i]);
+        } else if (!sameItem(curr.items[i], prev.items[i])) {
+            markDirty(frame, prev.items[i]);
+            markDirty(frame, curr.items[i]);
+        }
+    }
+}
+
+static bool covers(const DisplayItem &front, const DisplayItem &back) {
+    return front.minX <= back.minX && front.maxX >= back.maxX &&
+           front.minY <= back.minY && front.maxY >= back.maxY;
+}
+
+// Flag items wholly behind a later filled rect
+static int cullHidden(const DisplayList &list, uint32_t *culled) {
+    int count = 0;
+    for (int i = 0; i < list.count; i++) {
+        const DisplayItem &item = list.items[i];
+        if (item.kind == ITEM_TEXT) continue;   // Text is always on top
+        for (int j = i + 1; j < list.count; j++) {
+            const DisplayItem &front = list.items[j];
+            if (front.kind == ITEM_FILL_RECT && covers(front, item)) {
+                culled[i / 32] |= 1UL << (i % 32);
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+static void setRun(uint32_t *mask, int a, int b) {
+    for (int x = a; x <= b;) {
+        int bit = x % 32;
+        int n = min(32 - bit, b - x + 1);
+        mask[x / 32] |= (n == 32 ? ~0UL : ((1UL << n) - 1)) << bit;
+        x += n;
+    }
+}
+
+// First x in [x, end] whose mask bit equals want, or end + 1
+static int findBit(const uint32_t *mask, int x, int end, bool want) {
+    while (x <= end) {
+        uint32_t word = mask[x / 32];
+        if (!want) word = ~word;
+        word &= ~0UL << (x % 32);
+        if (word) {
+            return min(x - x % 32 + __builtin_ctz(word), end + 1);
+        }
+        x = x - x % 32 + 32;
+    }
+    return end + 1;
+}
+
+static void sortSegments(RowSegment *segments, int count) {
+    for (int i = 1; i < count; i++) {
+        RowSegment s = segments[i];
+        int j = i - 1;
+        while (j >= 0 && segments[j].x0 > s.x0) {
+            segments[j + 1] = segments[j];
+            j--;
+        }
+        segments[j + 1] = s;
+    }
+}
+
+// Write a scanline's visible runs left to right, joining neighbours of
+// the same colour
+static void flushSegments(DisplayFrame &frame, const DisplayList &list, int y,
+                          RowSegment *segments, int count) {
+    sortSegments(segments, count);
+
+    for (int i = 0; i < count;) {
+        const DisplayItem &item = list.items[segments[i].item];
+        int x0 = segments[i].x0;
+        int x1 = segments[i].x1;
+        i++;
+
+        if (item.kind == ITEM_IMAGE) {
+            // Grid cells take the image pixel at their top left corner
+            int s = item.size;
+            const uint16_t *row = (const uint16_t *)item.data + max((y << s) - item.y0, 0) * item.x1;
+            if (s == 0) {
+                lcdPixels(x0, y, x1 - x0 + 1, row + (x0 - item.x0));
+            } else {
+                uint16_t sampled[DISPLAY_WIDTH / 2];
+                for (int x = x0; x <= x1; x++) {
+                    sampled[x - x0] = row[max((x << s) - item.x0, 0)];
+                }
+                lcdPixels(x0, y, x1 - x0 + 1, sampled);
+            }
+        } else {
+            while (i < count && segments[i].x0 == x1 + 1 &&
+                   list.items[segments[i].item].kind != ITEM_IMAGE &&
+                   list.items[segments[i].item].color == item.color) {
+                x1 = segments[i].x1;
+                i++;
+            }
+            lcdSpan(x0, y, x1 - x0 + 1, item.color);
+        }
+        frame.stats.writes++;
+        frame.stats.pixels += x1 - x0 + 1;
+    }
+}
+
+void renderDisplayFrame(DisplayFrame &frame) {
+    const DisplayList &list = frame.lists[frame.current];
+    findDirtyCells(frame);
+    beginLcdFrame();
+    setLcdPixelDoubling(frame.shift);
+
+    uint32_t culled[MAX_DISPLAY_ITEMS / 32] = {0};
+    uint32_t textDue[MAX_DISPLAY_ITEMS / 32] = {0};
+    frame.stats.items = list.count;
+    frame.stats.culled = cullHidden(list, culled);
+    frame.stats.writes = 0;
+    frame.stats.pixels = 0;
+    frame.stats.dropped = list.dropped;
+    totals.frames++;
+    totals.dropped += list.dropped;
+
+    // Coverage outside the clip rect starts full
+    int clipX0, clipY0, clipX1, clipY1;
+    gridClip(frame, clipX0, clipY0, clipX1, clipY1);
+    uint32_t clipMask[DISPLAY_WORDS] = {0};
+    setRun(clipMask, clipX0, clipX1);
+
+    RowSegment segments[MAX_ROW_SEGMENTS];
+    for (int y = clipY0; y <= clipY1; y++) {
+        uint64_t cells = frame.dirty[y / DIRTY_CELL];
+        if (!cells) continue;
+
+        // Clear coverage over the dirty cells, inside the clip
+        uint32_t covered[DISPLAY_WORDS];
+        for (int w = 0; w < DISPLAY_WORDS; w++) covered[w] = 0xFFFFFFFF;
+        while (cells) {
+            int c = __builtin_ctzll(cells);
+            covered[c * DIRTY_CELL / 32] &= ~(0xFFUL << (c * DIRTY_CELL % 32));
+            cells &= cells - 1;
+        }
+        int open = 0;
+        for (int w = 0; w < DISPLAY_WORDS; w++) {
+            covered[w] |= ~clipMask[w];
+            open += __builtin_popcount(~covered[w]);
+        }
+
+        // Text goes on top: due wherever its box is dirty, and opaque text
+        // hides what is behind it
+        for (int i = 0; i < list.count; i++) {
+            const DisplayItem &item = list.items[i];
+            if (item.kind != ITEM_TEXT || y < item.minY || y > item.maxY) continue;
+            int a = max((int)item.minX, 0);
+            int b = min((int)item.maxX, DISPLAY_WIDTH - 1);
+            if (a > b || findBit(covered, a, b, false) > b) continue;
+            textDue[i / 32] |= 1UL << (i % 32);
+            if (item.opaque) {
+                for (int x = findBit(covered, a, b, false); x <= b;
+                     x = findBit(covered, x, b, false)) {
+                    int end = findBit(covered, x, b, true);
+                    open -= end - x;
+                    x = end;
+                }
+                setRun(covered, a, b);
+            }
+        }
+
+        // Everything else front to back; each run claims what is still open
+        int segmentCount = 0;
+        for (int i = list.count - 1; i >= 0 && open > 0; i--) {
+            const DisplayItem &item = list.items[i];
+            if (item.kind == ITEM_TEXT || y < item.minY || y > item.maxY) continue;
+            if (culled[i / 32] & (1UL << (i % 32))) continue;
+
+            int spans[4];
+            int spanCount = itemSpans(item, y, spans);
+            for (int s = 0; s < spanCount; s++) {
+                int a = max(spans[2 * s], 0);
+                int b = min(spans[2 * s + 1], DISPLAY_WIDTH - 1);
+                for (int x = findBit(covered, a, b, false); x <= b;
+                     x = findBit(covered, x, b, false)) {
+                    int end = findBit(covered, x, b, true);
+                    if (segmentCount == MAX_ROW_SEGMENTS) {
+                        flushSegments(frame, list, y, segments, segmentCount);
+                        segmentCount = 0;
+                    }
+                    segments[segmentCount].x0 = x;
+                    segments[segmentCount].x1 = end - 1;
+                    segments[segmentCount].item = i;
+                    segmentCount++;
+                    setRun(covered, x, end - 1);
+                    open -= end - x;
+                    x = end;
+                }
+            }
+        }
+        flushSegments(frame, list, y, segments, segmentCount);
+    }
+
+    setLcdPixelDoubling(false);
+    lcdBatchBreak();
+    for (int i = 0; i < list.count; i++) {
+        if (!(textDue[i / 32] & (1UL << (i % 32)))) continue;
+        const DisplayItem &item = list.items[i];
+        if (item.opaque) {
+            M5.Lcd.setTextColor(item.color, item.background);
+        } else {
+            M5.Lcd.setTextColor(item.color);
+        }
+        M5.Lcd.setTextSize(item.size);
+        M5.Lcd.setCursor(item.x0, item.y0);
+        M5.Lcd.print((const char *)item.data);
+        if (capturing()) {
+            captureRect(item.x0, item.y0,
+                        strlen((const char *)item.data) * GLYPH_WIDTH * item.size,
+                        GLYPH_HEIGHT * item.size);
+        }
+    }
+
+    endLcdFrame();
+
+    frame.fullRedraw = false;
+    frame.current ^= 1;
+}
+
+const DisplayTotals &displayTotals() {
+    return totals;
+}
+
+void resetDisplayTotals() {
+    memset(&totals, 0, sizeof(totals));
+}
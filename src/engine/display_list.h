@@ -0,0 +1,133 @@
+#ifndef DISPLAY_LIST_H
+#define DISPLAY_LIST_H
+
+#include <M5Stack.h>
+
+// Recorded drawing. A game records a frame's primitives into a display
+// list instead of drawing them, and the renderer works out what reached
+// the screen:
+//  - the list is compared with the previous frame's, and only screen
+//    cells under items that changed are repainted
+//  - items wholly covered by a later filled rect are culled
+//  - each dirty scanline is resolved front to back against a coverage
+//    mask, so every pixel is written once, by the item on top
+//  - runs of one colour on a scanline are merged into a single write
+//
+// Items are drawn in record order, later ones on top, except that text
+// always ends up above everything else. Text is drawn whole with the
+// built-in font; an opaque background makes it cover its box.
+//
+// A frame can render at half resolution. Items are still recorded in
+// screen coordinates, but are snapped to a 160x120 grid as they are
+// recorded, resolved there, and pixel-doubled on the way to the panel:
+// a quarter of the resolving work, for a blockier picture. Text stays
+// sharp, and images are sampled every other pixel.
+
+#define DISPLAY_WIDTH 320
+#define DISPLAY_HEIGHT 240
+#define DISPLAY_WORDS (DISPLAY_WIDTH / 32)     // Coverage mask words per scanline
+#define MAX_DISPLAY_ITEMS 256
+#define DISPLAY_TEXT_POOL 256                  // Characters of text per frame
+#define DIRTY_CELL 8                           // Repaint granularity in pixels
+#define DIRTY_COLS (DISPLAY_WIDTH / DIRTY_CELL)
+#define DIRTY_ROWS (DISPLAY_HEIGHT / DIRTY_CELL)
+#define MAX_ROW_SEGMENTS 96                    // Visible runs merged per scanline
+
+enum DisplayItemKind : uint8_t {
+    ITEM_FILL_RECT = 0,
+    ITEM_RECT,
+    ITEM_FILL_CIRCLE,
+    ITEM_CIRCLE,
+    ITEM_LINE,
+    ITEM_FILL_TRIANGLE,
+    ITEM_TEXT,
+    ITEM_IMAGE
+};
+
+// Compared byte for byte between frames, so records are zeroed first
+struct DisplayItem {
+    DisplayItemKind kind;
+    uint8_t size;              // Text size
+    bool opaque;               // Text with a background
+    uint16_t color;
+    uint16_t background;
+    int16_t x0, y0;            // Origin, circle centre or first vertex
+    int16_t x1, y1;            // Radius, image width or second vertex
+    int16_t x2, y2;            // Third vertex
+    int16_t minX, minY;        // Bounding box, inclusive
+    int16_t maxX, maxY;
+    const void *data;          // Image pixels or text in the list's pool; keep last
+};
+
+struct DisplayList {
+    DisplayItem items[MAX_DISPLAY_ITEMS];
+    int count;
+    char text[DISPLAY_TEXT_POOL];
+    int textUsed;
+    uint16_t dropped;          // Records that didn't fit
+    uint8_t shift;             // 1 when recording at half resolution
+};
+
+struct DisplayStats {
+    uint16_t items;
+    uint16_t culled;           // Items hidden behind a later filled rect
+    uint16_t writes;           // Scanline runs sent to the panel
+    uint32_t pixels;
+    uint16_t dropped;          // Records the frame lost for want of room
+};
+
+// Every frame rendered since the last reset, whichever DisplayFrame
+struct DisplayTotals {
+    uint32_t frames;
+    uint32_t dropped;
+};
+
+// Two lists, recorded into in turn, so each frame can be compared with
+// the one before
+struct DisplayFrame {
+    DisplayList lists[2];
+    int current;
+    bool fullRedraw;
+    uint8_t shift;                        // 1 at half resolution
+    int16_t clipX, clipY, clipW, clipH;   // Screen area the frame owns
+    uint64_t dirty[DIRTY_ROWS];           // Bit per DIRTY_CELL column
+    DisplayStats stats;
+};
+
+// The frame only ever draws inside the clip rect
+void initDisplayFrame(DisplayFrame &frame, int x, int y, int w, int h);
+
+// Start recording the next frame
+DisplayList &beginDisplayFrame(DisplayFrame &frame);
+
+// Repaint the whole clip rect at the next render, e.g. after fillScreen
+void invalidateDisplayFrame(DisplayFrame &frame);
+
+// Takes effect from the next beginDisplayFrame, with a full repaint. At
+// half resolution the clip rect is widened to even pixels.
+void setDisplayFrameHalfRes(DisplayFrame &frame, bool half);
+
+// Draw whatever changed since the previous render
+void renderDisplayFrame(DisplayFrame &frame);
+
+const DisplayTotals &displayTotals();
+void resetDisplayTotals();
+
+void recordFillRect(DisplayList &list, int x, int y, int w, int h, uint16_t color);
+void recordRect(DisplayList &list, int x, int y, int w, int h, uint16_t color);
+void recordFillCircle(DisplayList &list, int x, int y, int r, uint16_t color);
+void recordCircle(DisplayList &list, int x, int y, int r, uint16_t color);
+void recordLine(DisplayList &list, int x0, int y0, int x1, int y1, uint16_t color);
+void recordFillTriangle(DisplayList &list, int x0, int y0, int x1, int y1,
+                        int x2, int y2, uint16_t color);
+
+// Text with a transparent or an opaque background
+void recordText(DisplayList &list, int x, int y, const char *text, int size, uint16_t color);
+void recordText(DisplayList &list, int x, int y, const char *text, int size,
+                uint16_t color, uint16_t background);
+
+// pixels must stay valid until the render. Frames compare images by
+// address, so new contents need a new buffer or an invalidate.
+void recordImage(DisplayList &list, int x, int y, int w, int h, const uint16_t *pixels);
+
+#endif
@@ -0,0 +1,124 @@
+#include "font_cache.h"
+#include "lcd_batch.h"
+#include "screen_capture.h"
+
+#define LCD_WIDTH 320
+#define LCD_HEIGHT 240
+#define NOT_CACHED 0xFF
+
+static FontStats stats;
+
+bool cacheFont(FontCache &cache, const char *chars, int size) {
+    cache.size = size;
+    cache.count = 0;
+    memset(cache.index, NOT_CACHED, sizeof(cache.index));
+    if (size < 1 || size > FONT_MAX_SIZE) return false;
+
+    int rowsPerGlyph = FONT_GLYPH_HEIGHT * size;
+    int capacity = min(FONT_CACHE_GLYPHS, FONT_ROW_POOL / rowsPerGlyph);
+
+    // Let the library draw each glyph once into a cell-sized sprite
+    TFT_eSprite cell(&M5.Lcd);
+    cell.setColorDepth(16);
+    if (!cell.createSprite(FONT_GLYPH_WIDTH, FONT_GLYPH_HEIGHT)) return false;
+
+    bool fits = true;
+    for (const char *c = chars; *c; c++) {
+        int code = (uint8_t)*c;
+        if (code < 32 || code > 127 || cache.index[code - 32] != NOT_CACHED) continue;
+        if (cache.count == capacity) {
+            fits = false;
+            continue;
+        }
+
+        cell.fillSprite(TFT_BLACK);
+        cell.drawChar(0, 0, code, TFT_WHITE, TFT_BLACK, 1);
+        uint8_t glyph[FONT_GLYPH_HEIGHT] = {0};
+        for (int y = 0; y < FONT_GLYPH_HEIGHT; y++) {
+            for (int x = 0; x < FONT_GLYPH_WIDTH; x++) {
+                if (cell.readPixel(x, y) != TFT_BLACK) glyph[y] |= 1 << x;
+            }
+        }
+
+        // Scale up once here rather than on every draw
+        uint32_t *rows = cache.rows + cache.count * rowsPerGlyph;
+        for (int y = 0; y < rowsPerGlyph; y++) {
+            uint32_t row = 0;
+            for (int x = 0; x < FONT_GLYPH_WIDTH * size; x++) {
+                if (glyph[y / size] & (1 << (x / size))) row |= 1UL << x;
+            }
+            rows[y] = row;
+        }
+        cache.index[code - 32] = cache.count++;
+    }
+
+    cell.deleteSprite();
+    return fits;
+}
+
+static bool cached(const FontCache &cache, const char *text) {
+    for (const char *c = text; *c; c++) {
+        int code = (uint8_t)*c;
+        if (code < 32 || code > 127 || cache.index[code - 32] == NOT_CACHED) return false;
+    }
+    return true;
+}
+
+void drawCachedText(const FontCache &cache, int x, int y, const char *text,
+                    uint16_t color, uint16_t background) {
+    int len = strlen(text);
+    if (len == 0) return;
+
+    int cellWidth = FONT_GLYPH_WIDTH * cache.size;
+    int rowsPerGlyph = FONT_GLYPH_HEIGHT * cache.size;
+    int w = len * cellWidth;
+    int h = rowsPerGlyph;
+
+    if (x < 0 || y < 0 || x + w > LCD_WIDTH || y + h > LCD_HEIGHT || !cached(cache, text)) {
+        lcdBatchBreak();
+        M5.Lcd.setTextSize(cache.size);
+        M5.Lcd.setTextColor(color, background);
+        M5.Lcd.setCursor(x, y);
+        M5.Lcd.print(text);
+        // Text past the right edge wraps onto the next line
+        if (capturing()) {
+            bool wraps = x + w > LCD_WIDTH;
+            captureRect(wraps ? 0 : x, y, wraps ? LCD_WIDTH : w, wraps ? 2 * h : h);
+        }
+        return;
+    }
+
+    uint32_t start = micros();
+    static uint16_t band[FONT_BAND_PIXELS];
+    uint16_t fg = (color >> 8) | (color << 8);
+    uint16_t bg = (background >> 8) | (background << 8);
+    int bandRows = FONT_BAND_PIXELS / w;
+
+    beginLcdFrame();
+    lcdWindow(x, y, w, h);
+    for (int top = 0; top < h; top += bandRows) {
+        int bottom = min(top + bandRows, h);
+        uint16_t *out = band;
+        for (int row = top; row < bottom; row++) {
+            for (const char *c = text; *c; c++) {
+                uint32_t mask = cache.rows[cache.index[(uint8_t)*c - 32] * rowsPerGlyph + row];
+                for (int px = 0; px < cellWidth; px++) {
+                    *out++ = (mask >> px) & 1 ? fg : bg;
+                }
+            }
+        }
+        lcdStream(band, out - band);
+    }
+    endLcdFrame();
+
+    stats.glyphs += len;
+    stats.micros += micros() - start;
+}
+
+const FontStats &fontStats() {
+    return stats;
+}
+
+void resetFontStats() {
+    memset(&stats, 0, sizeof(stats));
+}
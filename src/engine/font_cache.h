@@ -0,0 +1,50 @@
+#ifndef FONT_CACHE_H
+#define FONT_CACHE_H
+
+#include <M5Stack.h>
+
+// Pre-rasterised text for HUDs that redraw every frame. The LCD library
+// draws built-in font text a scaled glyph pixel at a time; a cache holds
+// the glyphs a game uses, already scaled, as 1bpp rows, and a string goes
+// out as one window and one bulk push of its whole box.
+//
+// A cache holds one text size. Glyphs are captured from the library's own
+// font, so cached text looks exactly like printed text. Strings with a
+// character that isn't cached, or that run off screen, are printed the
+// ordinary way.
+
+#define FONT_CACHE_GLYPHS 40
+#define FONT_ROW_POOL 512          // Scaled glyph rows shared by the glyphs
+#define FONT_GLYPH_WIDTH 6         // Cell at text size 1, spacing included
+#define FONT_GLYPH_HEIGHT 8
+#define FONT_BAND_PIXELS 1024      // Pixels composed per push
+#define FONT_MAX_SIZE 5            // Largest text size whose scaled rows fit 32 bits
+
+static_assert(FONT_GLYPH_WIDTH * FONT_MAX_SIZE <= 32, "scaled glyph rows overflow uint32_t");
+
+struct FontCache {
+    uint8_t size;
+    uint8_t count;
+    uint8_t index[96];             // Glyph slot for ASCII 32..127, 0xFF if not cached
+    uint32_t rows[FONT_ROW_POOL];  // Slot g: FONT_GLYPH_HEIGHT * size rows, bit x for column x
+};
+
+// Totals since the last reset, for glyphs per millisecond
+struct FontStats {
+    uint32_t glyphs;
+    uint32_t micros;
+};
+
+// Rasterise chars at the given text size. Returns false if some didn't fit,
+// or if size is past FONT_MAX_SIZE, in which case nothing is cached and
+// text is printed.
+bool cacheFont(FontCache &cache, const char *chars, int size);
+
+// Opaque text at (x, y), like print with setTextColor(color, background)
+void drawCachedText(const FontCache &cache, int x, int y, const char *text,
+                    uint16_t color, uint16_t background);
+
+const FontStats &fontStats();
+void resetFontStats();
+
+#endif
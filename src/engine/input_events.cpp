@@ -0,0 +1,86 @@
+#include "input_events.h"
+
+void initInputQueue(InputQueue &queue, uint8_t state) {
+    queue.head = 0;
+    queue.count = 0;
+    queue.state = state;
+}
+
+void pushInputState(InputQueue &queue, uint8_t pressed, uint32_t time) {
+    uint8_t changed = pressed ^ queue.state;
+    if (!changed) return;
+    queue.state = pressed;
+
+    if (queue.count == INPUT_QUEUE_SIZE) {
+        // Full: fold into the newest event rather than lose a release
+        InputEvent &last = queue.events[(queue.head + queue.count - 1) % INPUT_QUEUE_SIZE];
+        last.pressed = pressed;
+        last.changed |= changed;
+        return;
+    }
+
+    InputEvent &event = queue.events[(queue.head + queue.count) % INPUT_QUEUE_SIZE];
+    event.time = time;
+    event.pressed = pressed;
+    event.changed = changed;
+    queue.count++;
+}
+
+bool popInputEvent(InputQueue &queue, InputEvent &event) {
+    if (queue.count == 0) return false;
+
+    event = queue.events[queue.head];
+    queue.head = (queue.head + 1) % INPUT_QUEUE_SIZE;
+    queue.count--;
+    return true;
+}
+
+void initAutoShift(AutoShift &shift, uint16_t das, uint16_t arr) {
+    shift.das = das;
+    shift.arr = arr;
+    shift.dir = 0;
+    shift.held[0] = false;
+    shift.held[1] = false;
+    shift.charged = false;
+    shift.nextTime = 0;
+}
+
+int8_t autoShiftPress(AutoShift &shift, int8_t dir, uint32_t time) {
+    shift.held[dir > 0] = true;
+    shift.dir = dir;
+    shift.charged = false;
+    shift.nextTime = time + shift.das;
+    return dir;
+}
+
+void autoShiftRelease(AutoShift &shift, int8_t dir, uint32_t time) {
+    shift.held[dir > 0] = false;
+    if (shift.dir != dir) return;
+
+    // Fall back to the other direction if it is still held, from scratch
+    int8_t other = -dir;
+    if (shift.held[other > 0]) {
+        shift.dir = other;
+        shift.charged = false;
+        shift.nextTime = time + shift.das;
+    } else {
+        shift.dir = 0;
+    }
+}
+
+bool autoShiftDue(const AutoShift &shift, uint32_t until, uint32_t &time) {
+    if (shift.dir == 0 || autoShiftInstant(shift)) return false;
+    if ((int32_t)(shift.nextTime - until) > 0) return false;
+    time = shift.nextTime;
+    return true;
+}
+
+int8_t autoShiftFire(AutoShift &shift) {
+    shift.charged = true;
+    shift.nextTime += shift.arr;
+    return shift.dir;
+}
+
+bool autoShiftInstant(const AutoShift &shift) {
+    return shift.dir != 0 && shift.charged && shift.arr == AUTO_SHIFT_INSTANT;
+}
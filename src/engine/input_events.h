@@ -0,0 +1,61 @@
+#ifndef INPUT_EVENTS_H
+#define INPUT_EVENTS_H
+
+#include <M5Stack.h>
+
+// Timestamped button changes and delayed auto-shift (DAS/ARR). Games poll
+// the buttons more often than they draw, queue each change with the time
+// it was seen, and replay the queue in order, so a move lands at the time
+// of the press rather than at the next frame.
+
+#define INPUT_QUEUE_SIZE 16
+#define AUTO_SHIFT_INSTANT 0   // ARR that slides straight to the wall
+
+// A change in the pressed-button mask, set bits held
+struct InputEvent {
+    uint32_t time;
+    uint8_t pressed;           // All buttons down after this change
+    uint8_t changed;           // Buttons that went up or down
+};
+
+struct InputQueue {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    int head;
+    int count;
+    uint8_t state;             // Pressed mask as of the newest event
+};
+
+// Start empty, treating the buttons in state as already held
+void initInputQueue(InputQueue &queue, uint8_t state);
+
+// Queue the buttons if they differ from the last state seen
+void pushInputState(InputQueue &queue, uint8_t pressed, uint32_t time);
+
+bool popInputEvent(InputQueue &queue, InputEvent &event);
+
+// One left/right axis. The newest held direction wins, and shifts again
+// das ms after its press and every arr ms after that.
+struct AutoShift {
+    uint16_t das, arr;
+    int8_t dir;                // Active direction, -1, 0 or +1
+    bool held[2];              // Left, right
+    bool charged;              // DAS has elapsed for the active direction
+    uint32_t nextTime;         // Next repeat while dir != 0
+};
+
+void initAutoShift(AutoShift &shift, uint16_t das, uint16_t arr);
+
+// Returns the direction to shift right away
+int8_t autoShiftPress(AutoShift &shift, int8_t dir, uint32_t time);
+void autoShiftRelease(AutoShift &shift, int8_t dir, uint32_t time);
+
+// True if a repeat falls at or before until, with its time
+bool autoShiftDue(const AutoShift &shift, uint32_t until, uint32_t &time);
+
+// Consume the due repeat and return its direction
+int8_t autoShiftFire(AutoShift &shift);
+
+// With an instant ARR the piece should hug the wall from DAS onwards
+bool autoShiftInstant(const AutoShift &shift);
+
+#endif
@@ -0,0 +1,161 @@
+#include "lcd_batch.h"
+#include "screen_capture.h"
+
+#define LCD_WIDTH 320
+#define LCD_HEIGHT 240
+
+// Pixels waiting to go out, one run on one row, kept in panel byte order
+static uint16_t bounce[LCD_BOUNCE_PIXELS];
+static int runX, runY, runCount;
+
+// Address window the panel is streaming into, and the row it is up to
+static bool windowOpen = false;
+static int windowX0, windowX1, windowNextY;
+
+static int depth = 0;
+static LcdBatchStats stats;
+
+static bool doubling = false;  // Queued runs are doubled rows, sent twice
+
+static void flushRun() {
+    if (runCount == 0) return;
+
+    // Cheap when the bus is still held, and a direct draw may have let it go
+    M5.Lcd.startWrite();
+    int x1 = runX + runCount - 1;
+    if (!LCD_BATCH || !windowOpen || windowX0 != runX || windowX1 != x1 ||
+        windowNextY != runY) {
+        // Open to the bottom of the screen so later rows with the same
+        // columns can carry on streaming
+        M5.Lcd.setWindow(runX, runY, x1, LCD_HEIGHT - 1);
+        windowOpen = true;
+        windowX0 = runX;
+        windowX1 = x1;
+        stats.windows++;
+    }
+    // A doubled row carries straight on into the window's next row
+    int rows = doubling ? 2 : 1;
+    for (int y = runY; y < runY + rows; y++) {
+        M5.Lcd.pushColors(bounce, runCount, false);
+        if (capturing()) captureRun(runX, y, runCount, bounce);
+    }
+    windowNextY = runY + rows;
+    stats.pushes += rows;
+    stats.pixels += runCount * rows;
+    runCount = 0;
+#if !LCD_BATCH
+    M5.Lcd.endWrite();
+#endif
+}
+
+// Room in the bounce buffer for w pixels at (x, y), continuing the run
+static uint16_t *queueRun(int x, int y, int w) {
+    if (runCount > 0 && (!LCD_BATCH || y != runY || x != runX + runCount ||
+                         runCount + w > LCD_BOUNCE_PIXELS)) {
+        flushRun();
+    }
+    if (runCount == 0) {
+        runX = x;
+        runY = y;
+    }
+    uint16_t *out = bounce + runCount;
+    runCount += w;
+    stats.spans++;
+    return out;
+}
+
+void lcdBatchBreak() {
+    flushRun();
+    windowOpen = false;
+}
+
+void beginLcdFrame() {
+    if (depth++ > 0) return;
+    if (LCD_BATCH) M5.Lcd.startWrite();
+    windowOpen = false;
+    runCount = 0;
+    stats.frames++;
+}
+
+void endLcdFrame() {
+    // An inner frame leaves the panel ready for direct drawing too
+    lcdBatchBreak();
+    if (--depth == 0) M5.Lcd.endWrite();
+}
+
+void lcdSpan(int x, int y, int w, uint16_t color) {
+    int shift = doubling ? 1 : 0;
+    if (y < 0 || y >= LCD_HEIGHT >> shift) return;
+    if (x < 0) { w += x; x = 0; }
+    if (x + w > LCD_WIDTH >> shift) w = (LCD_WIDTH >> shift) - x;
+    if (w <= 0) return;
+
+    w <<= shift;
+    uint16_t *out = queueRun(x << shift, y << shift, w);
+    uint16_t swapped = (color >> 8) | (color << 8);
+    for (int i = 0; i < w; i++) out[i] = swapped;
+}
+
+void lcdPixels(int x, int y, int w, const uint16_t *pixels) {
+    int shift = doubling ? 1 : 0;
+    if (y < 0 || y >= LCD_HEIGHT >> shift) return;
+    if (x < 0) { w += x; pixels -= x; x = 0; }
+    if (x + w > LCD_WIDTH >> shift) w = (LCD_WIDTH >> shift) - x;
+    if (w <= 0) return;
+
+    uint16_t *out = queueRun(x << shift, y << shift, w << shift);
+    if (!doubling) {
+        memcpy(out, pixels, w * sizeof(uint16_t));
+        return;
+    }
+    for (int i = 0; i < w; i++) {
+        out[2 * i] = out[2 * i + 1] = pixels[i];
+    }
+}
+
+void setLcdPixelDoubling(bool on) {
+    // Queued runs were widened for the old setting
+    flushRun();
+    doubling = on;
+}
+
+void lcdWindow(int x, int y, int w, int h) {
+    flushRun();
+    M5.Lcd.startWrite();
+    M5.Lcd.setWindow(x, y, x + w - 1, y + h - 1);
+    // Not a window queued runs can carry on into
+    windowOpen = false;
+    stats.windows++;
+    if (capturing()) captureWindow(x, y, w, h);
+    stats.spans++;
+}
+
+void lcdStream(const uint16_t *pixels, int count) {
+    M5.Lcd.pushColors((uint16_t *)pixels, count, false);
+    stats.pushes++;
+    stats.pixels += count;
+    if (capturing()) captureStream(pixels, count);
+}
+
+const LcdBatchStats &lcdBatchStats() {
+    return stats;
+}
+
+void resetLcdBatchStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+static uint32_t wireMicros(uint32_t bytes) {
+    return (uint64_t)bytes * 8 * 1000000 / LCD_SPI_HZ;
+}
+
+uint32_t lcdBusMicros(const LcdBatchStats &counts) {
+    return wireMicros(counts.windows * LCD_WINDOW_BYTES + counts.pixels * 2) +
+           counts.frames * LCD_TRANSACTION_US + counts.windows * LCD_WINDOW_US +
+           counts.pushes * LCD_PUSH_US;
+}
+
+uint32_t lcdUnbatchedMicros(const LcdBatchStats &counts) {
+    return wireMicros(counts.spans * LCD_WINDOW_BYTES + counts.pixels * 2) +
+           counts.spans * (LCD_TRANSACTION_US + LCD_WINDOW_US + LCD_PUSH_US);
+}
@@ -0,0 +1,86 @@
+#ifndef LCD_BATCH_H
+#define LCD_BATCH_H
+
+#include <M5Stack.h>
+
+// Batched scanline writes to the LCD. Every M5.Lcd drawing call takes and
+// releases the SPI bus and sends its own address window, which costs more
+// than the pixels for the short runs games draw most. Inside a frame:
+//  - the bus is taken once, at the outermost beginLcdFrame
+//  - runs that continue one another on a row are gathered in a bounce
+//    buffer and sent as one window and one push
+//  - a row sent with the same columns as the row above it goes into the
+//    window already open, without a new address command
+//
+// With pixel doubling on, lcdSpan and lcdPixels take coordinates on a
+// 160x120 grid and every pixel goes out as a 2x2 block. A row is widened
+// once in the bounce buffer and pushed twice into the same window, so
+// doubling costs no more memory than a row.
+//
+// Frames nest, so a renderer can open its own frame inside a game's.
+// Anything drawn with M5.Lcd directly inside a frame must come after
+// lcdBatchBreak, since it moves the panel's address window. In_eSPI's
+// shape and text calls also end the bus transaction when they finish,
+// whoever started it, so the bus is taken again before every window.
+
+#ifndef LCD_BATCH
+#define LCD_BATCH 1                // 0 sends every span on its own, to compare
+#endif
+
+#define LCD_BOUNCE_PIXELS 320
+
+// Bus cost model for the ILI9342. Wall time spent in the game loop hides
+// where it goes; the panel is fed over SPI, so what a frame costs is
+// mostly bytes on the bus plus fixed costs per transaction, per address
+// window and per push. The fixed costs are rough figures for a Core.
+// Only what goes through lcd_batch is counted.
+#ifdef SPI_FREQUENCY
+#define LCD_SPI_HZ SPI_FREQUENCY
+#else
+#define LCD_SPI_HZ 40000000
+#endif
+#define LCD_WINDOW_BYTES 11        // CASET and PASET with 4 data bytes each, RAMWR
+#define LCD_TRANSACTION_US 2       // Taking and releasing the bus
+#define LCD_WINDOW_US 1            // Switching DC between command and data
+#define LCD_PUSH_US 1              // Setting up a push
+
+// Totals since the last reset. Unbatched, every span is a bus transaction
+// plus a window plus a push, so spans against windows and pushes is the
+// saving.
+struct LcdBatchStats {
+    uint32_t frames;
+    uint32_t spans;        // lcdSpan, lcdPixels and lcdWindow calls
+    uint32_t windows;      // Address windows sent
+    uint32_t pushes;       // Pixel pushes sent
+    uint32_t pixels;
+};
+
+void beginLcdFrame();
+void endLcdFrame();
+
+// Send anything queued and forget the open window
+void lcdBatchBreak();
+
+void lcdSpan(int x, int y, int w, uint16_t color);
+
+// A row of image pixels, in the byte order pushImage takes
+void lcdPixels(int x, int y, int w, const uint16_t *pixels);
+
+// Half-resolution coordinates for lcdSpan and lcdPixels, as above
+void setLcdPixelDoubling(bool on);
+
+// A whole w x h block: one window, then the pixels row by row in one or
+// more lcdStream calls, in pushImage byte order. The block must be on
+// screen.
+void lcdWindow(int x, int y, int w, int h);
+void lcdStream(const uint16_t *pixels, int count);
+
+const LcdBatchStats &lcdBatchStats();
+void resetLcdBatchStats();
+
+// Estimated bus time for the given counts, batched as they were, and as
+// they would have been with every span drawn on its own
+uint32_t lcdBusMicros(const LcdBatchStats &counts);
+uint32_t lcdUnbatchedMicros(const LcdBatchStats &counts);
+
+#endif
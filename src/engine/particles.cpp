@@ -0,0 +1,102 @@
+#include "particles.h"
+
+void initParticles(ParticlePool &pool, int16_t minX, int16_t minY,
+                   int16_t maxX, int16_t maxY, bool wrap, uint32_t seed) {
+    pool.count = 0;
+    pool.minX = minX;
+    pool.minY = minY;
+    pool.maxX = maxX;
+    pool.maxY = maxY;
+    pool.wrap = wrap;
+    pool.seed = seed ? seed : 1;   // xorshift is stuck at zero
+}
+
+uint32_t particleRandom(ParticlePool &pool) {
+    uint32_t s = pool.seed;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    pool.seed = s;
+    return s;
+}
+
+int spawnParticle(ParticlePool &pool, int x, int y, int vx, int vy,
+                  uint16_t color, uint8_t life) {
+    if (pool.count >= MAX_PARTICLES || life == 0) return -1;
+
+    int i = pool.count++;
+    pool.x[i] = (int32_t)x << PARTICLE_SHIFT;
+    pool.y[i] = (int32_t)y << PARTICLE_SHIFT;
+    pool.vx[i] = vx;
+    pool.vy[i] = vy;
+    pool.color[i] = color;
+    pool.life[i] = life;
+    return i;
+}
+
+void spawnParticleBurst(ParticlePool &pool, int x, int y, int speed, int count,
+                        uint16_t color, uint8_t life) {
+    for (int n = 0; n < count; n++) {
+        // Uniform box of velocities; close enough to round for a few frames
+        int vx = (int)(particleRandom(pool) % (2 * speed + 1)) - speed;
+        int vy = (int)(particleRandom(pool) % (2 * speed + 1)) - speed;
+        if (spawnParticle(pool, x, y, vx, vy, color, life) < 0) return;
+    }
+}
+
+void updateParticles(ParticlePool &pool, int32_t scale) {
+    const int32_t minX = (int32_t)pool.minX << PARTICLE_SHIFT;
+    const int32_t minY = (int32_t)pool.minY << PARTICLE_SHIFT;
+    const int32_t maxX = (int32_t)pool.maxX << PARTICLE_SHIFT;
+    const int32_t maxY = (int32_t)pool.maxY << PARTICLE_SHIFT;
+    const int width = pool.maxX - pool.minX;
+    const int height = pool.maxY - pool.minY;
+
+    for (int i = 0; i < pool.count; i++) {
+        if (pool.life[i] == 0) continue;
+        if (pool.life[i] != PARTICLE_FOREVER) pool.life[i]--;
+
+        pool.x[i] += (pool.vx[i] * scale) >> PARTICLE_SHIFT;
+        pool.y[i] += (pool.vy[i] * scale) >> PARTICLE_SHIFT;
+
+        bool outX = pool.x[i] < minX || pool.x[i] >= maxX;
+        bool outY = pool.y[i] < minY || pool.y[i] >= maxY;
+        if (!outX && !outY) continue;
+
+        if (!pool.wrap) {
+            pool.life[i] = 0;
+            continue;
+        }
+
+        // Re-enter at the far edge, scattered along it
+        if (outY) {
+            pool.y[i] += (pool.y[i] < minY ? height : -height) << PARTICLE_SHIFT;
+            pool.x[i] = minX + (int32_t)(particleRandom(pool) % (width << PARTICLE_SHIFT));
+        } else {
+            pool.x[i] += (pool.x[i] < minX ? width : -width) << PARTICLE_SHIFT;
+            pool.y[i] = minY + (int32_t)(particleRandom(pool) % (height << PARTICLE_SHIFT));
+        }
+        pool.x[i] = constrain(pool.x[i], minX, maxX - 1);
+        pool.y[i] = constrain(pool.y[i], minY, maxY - 1);
+    }
+}
+
+static void removeParticle(ParticlePool &pool, int i) {
+    int last = --pool.count;
+    pool.x[i] = pool.x[last];
+    pool.y[i] = pool.y[last];
+    pool.vx[i] = pool.vx[last];
+    pool.vy[i] = pool.vy[last];
+    pool.color[i] = pool.color[last];
+    pool.life[i] = pool.life[last];
+}
+
+void recordParticles(ParticlePool &pool, DisplayList &list) {
+    for (int i = pool.count - 1; i >= 0; i--) {
+        if (pool.life[i] == 0) removeParticle(pool, i);
+    }
+    for (int i = 0; i < pool.count; i++) {
+        recordFillRect(list, pool.x[i] >> PARTICLE_SHIFT, pool.y[i] >> PARTICLE_SHIFT,
+                       1, 1, pool.color[i]);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <M5Stack.h>
+#include "display_list.h"
+
+// Fixed-capacity pool of single-pixel particles for starfields, exhaust
+// and debris. Positions and velocities are 8.8 fixed point in parallel
+// arrays. Pools are drawn through a display list, which works out what
+// changed on screen.
+
+#define MAX_PARTICLES 64
+#define PARTICLE_SHIFT 8
+#define PARTICLE_ONE (1 << PARTICLE_SHIFT)
+#define PARTICLE_FOREVER 0xFF  // Life for particles that never expire
+
+struct ParticlePool {
+    int32_t x[MAX_PARTICLES], y[MAX_PARTICLES];
+    int16_t vx[MAX_PARTICLES], vy[MAX_PARTICLES];    // 8.8 pixels per update
+    uint16_t color[MAX_PARTICLES];
+    uint8_t life[MAX_PARTICLES];   // Updates left, 0 once dead
+    int count;
+    int16_t minX, minY, maxX, maxY;  // Particles leaving this box wrap or die
+    bool wrap;                       // Re-enter at the opposite edge
+    uint32_t seed;
+};
+
+void initParticles(ParticlePool &pool, int16_t minX, int16_t minY,
+                   int16_t maxX, int16_t maxY, bool wrap, uint32_t seed);
+
+// Cheap xorshift step, so effects don't touch the Arduino random() state
+uint32_t particleRandom(ParticlePool &pool);
+
+// Position in pixels, velocity in 8.8. Returns the index, or -1 when full.
+int spawnParticle(ParticlePool &pool, int x, int y, int vx, int vy,
+                  uint16_t color, uint8_t life);
+
+// Scatter up to count particles from a point in random directions
+void spawnParticleBurst(ParticlePool &pool, int x, int y, int speed, int count,
+                        uint16_t color, uint8_t life);
+
+// Advance by velocity * scale, with scale in 8.8 (PARTICLE_ONE is 1x)
+void updateParticles(ParticlePool &pool, int32_t scale);
+
+// Drop the dead and record the rest as pixels
+void recordParticles(ParticlePool &pool, DisplayList &list);
+
+#endif
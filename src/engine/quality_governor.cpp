@@ -0,0 +1,62 @@
+#include "quality_governor.h"
+#include "debug_stats.h"
+
+static QualityStats stats;
+
+void initQualityGovernor(QualityGovernor &governor, int frameMs, int maxLevel) {
+    governor.level = 0;
+    governor.maxLevel = min(maxLevel, QUALITY_MAX_LEVELS - 1);
+    governor.budgetMicros = frameMs * 1000UL;
+    governor.average = 0;
+    governor.over = 0;
+    governor.under = 0;
+}
+
+bool updateQualityGovernor(QualityGovernor &governor, uint32_t frameMicros) {
+    stats.frames[governor.level]++;
+
+    // Exponential average, so one slow frame doesn't cost a level
+    if (governor.average == 0) {
+        governor.average = frameMicros;
+    } else {
+        governor.average += ((int32_t)frameMicros - (int32_t)governor.average) >> QUALITY_SMOOTHING;
+    }
+
+    if (governor.average > governor.budgetMicros) {
+        governor.over++;
+        governor.under = 0;
+    } else if (governor.average < governor.budgetMicros * QUALITY_HEADROOM / 100) {
+        governor.under++;
+        governor.over = 0;
+    } else {
+        governor.over = 0;
+        governor.under = 0;
+    }
+
+    int level = governor.level;
+    if (governor.over >= QUALITY_DOWN_FRAMES && level < governor.maxLevel) {
+        level++;
+    } else if (governor.under >= QUALITY_UP_FRAMES && level > 0) {
+        level--;
+    } else {
+        return false;
+    }
+
+#if DEBUG_STATS
+    Serial.printf("Quality: level %d, frame %lu us of %lu\n", level,
+                  (unsigned long)governor.average, (unsigned long)governor.budgetMicros);
+#endif
+    governor.level = level;
+    governor.over = 0;
+    governor.under = 0;
+    stats.changes++;
+    return true;
+}
+
+const QualityStats &qualityStats() {
+    return stats;
+}
+
+void resetQualityStats() {
+    memset(&stats, 0, sizeof(stats));
+}
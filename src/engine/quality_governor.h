@@ -0,0 +1,45 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <M5Stack.h>
+
+// Trades detail for frame rate. A game reports how long each frame's work
+// took, and the governor steps its quality level down (a higher number)
+// when the smoothed time stays over the frame budget, and back up when it
+// has stayed comfortably under for a while. What each level turns off is
+// up to the game; level 0 is full quality.
+//
+// The wait to step up is much longer than the wait to step down, so a
+// game that only just fits its budget settles rather than flickering
+// between two levels.
+
+#define QUALITY_MAX_LEVELS 8
+#define QUALITY_SMOOTHING 3            // Average over about 2^3 frames
+#define QUALITY_DOWN_FRAMES 10         // Over budget this long drops a level
+#define QUALITY_UP_FRAMES 120          // Under the headroom this long raises one
+#define QUALITY_HEADROOM 75            // Percent of the budget
+
+struct QualityGovernor {
+    uint8_t level;
+    uint8_t maxLevel;
+    uint32_t budgetMicros;
+    uint32_t average;          // Smoothed frame time
+    int over;                  // Frames in a row over budget
+    int under;                 // Frames in a row under the headroom
+};
+
+// Totals since the last reset, for the profile on the way back to the menu
+struct QualityStats {
+    uint32_t frames[QUALITY_MAX_LEVELS];   // Frames run at each level
+    uint32_t changes;
+};
+
+void initQualityGovernor(QualityGovernor &governor, int frameMs, int maxLevel);
+
+// Feed one frame's work time. Returns true if the level changed.
+bool updateQualityGovernor(QualityGovernor &governor, uint32_t frameMicros);
+
+const QualityStats &qualityStats();
+void resetQualityStats();
+
+#endif
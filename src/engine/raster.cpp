@@ -0,0 +1,220 @@
+#include "raster.h"
+#include "lcd_batch.h"
+
+// floor(sqrt(r^2 - dy^2 + r)), for the ball and the bumpers and their
+// outlines; raster_test checks them against the formula
+static const uint8_t CIRCLE_4[] = {4, 4, 4, 3, 2};
+static const uint8_t CIRCLE_12[] = {12, 12, 12, 12, 11, 11, 10, 10, 9, 8, 7, 5, 3};
+static const uint8_t CIRCLE_13[] = {13, 13, 13, 13, 12, 12, 12, 11, 10, 10, 9, 7, 6, 3};
+
+const uint8_t *circleSpanTable(int r) {
+    switch (r) {
+        case 4: return CIRCLE_4;
+        case 12: return CIRCLE_12;
+        case 13: return CIRCLE_13;
+    }
+    return NULL;
+}
+
+int circleHalfWidth(int r, int dy) {
+    if (dy < -r || dy > r) return -1;
+    const uint8_t *table = circleSpanTable(r);
+    if (table) return table[abs(dy)];
+    return (int)sqrtf((float)(r * r - dy * dy + r));
+}
+
+bool polygonSpan(const int16_t *xs, const int16_t *ys, int count, int y, int &x0, int &x1) {
+    bool found = false;
+    for (int i = 0; i < count; i++) {
+        int j = i + 1 == count ? 0 : i + 1;
+        int py = ys[i], qy = ys[j];
+        if (y < min(py, qy) || y > max(py, qy)) continue;
+
+        // Any edge crossing the row bounds it on one side or the other;
+        // a flat edge on the row contributes both ends
+        int a, b;
+        if (py == qy) {
+            a = min(xs[i], xs[j]);
+            b = max(xs[i], xs[j]);
+        } else {
+            a = b = xs[i] + divRound((y - py) * (xs[j] - xs[i]), qy - py);
+        }
+        if (!found) {
+            x0 = a;
+            x1 = b;
+            found = true;
+        } else {
+            x0 = min(x0, a);
+            x1 = max(x1, b);
+        }
+    }
+    return found;
+}
+
+void initCapsule(Capsule &capsule, int x0, int y0, int r0, int x1, int y1, int r1) {
+    capsule.x0 = x0; capsule.y0 = y0; capsule.r0 = r0;
+    capsule.x1 = x1; capsule.y1 = y1; capsule.r1 = r1;
+    capsule.minY = min(y0 - r0, y1 - r1);
+    capsule.maxY = max(y0 + r0, y1 + r1);
+
+    // Unit normal to the axis; a disc spans about r + 0.5 pixels either
+    // side of its centre, so the band does too
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float len = sqrtf(dx * dx + dy * dy);
+    float nx = len > 0 ? -dy / len : 0;
+    float ny = len > 0 ? dx / len : 0;
+    float w0 = r0 + 0.5f;
+    float w1 = r1 + 0.5f;
+
+    capsule.bandX[0] = lroundf(x0 + nx * w0); capsule.bandY[0] = lroundf(y0 + ny * w0);
+    capsule.bandX[1] = lroundf(x1 + nx * w1); capsule.bandY[1] = lroundf(y1 + ny * w1);
+    capsule.bandX[2] = lroundf(x1 - nx * w1); capsule.bandY[2] = lroundf(y1 - ny * w1);
+    capsule.bandX[3] = lroundf(x0 - nx * w0); capsule.bandY[3] = lroundf(y0 - ny * w0);
+}
+
+bool capsuleSpan(const Capsule &capsule, int y, int &x0, int &x1) {
+    if (y < capsule.minY || y > capsule.maxY) return false;
+
+    // The shape is convex, so its row is one run from the leftmost to the
+    // rightmost of the pieces' runs
+    bool found = polygonSpan(capsule.bandX, capsule.bandY, 4, y, x0, x1);
+    int hw = circleHalfWidth(capsule.r0, y - capsule.y0);
+    if (hw >= 0) {
+        x0 = found ? min(x0, capsule.x0 - hw) : capsule.x0 - hw;
+        x1 = found ? max(x1, capsule.x0 + hw) : capsule.x0 + hw;
+        found = true;
+    }
+    hw = circleHalfWidth(capsule.r1, y - capsule.y1);
+    if (hw >= 0) {
+        x0 = found ? min(x0, capsule.x1 - hw) : capsule.x1 - hw;
+        x1 = found ? max(x1, capsule.x1 + hw) : capsule.x1 + hw;
+        found = true;
+    }
+    return found;
+}
+
+void fillPolygon(const int16_t *xs, const int16_t *ys, int count, uint16_t color) {
+    int top = ys[0], bottom = ys[0];
+    for (int i = 1; i < count; i++) {
+        top = min(top, (int)ys[i]);
+        bottom = max(bottom, (int)ys[i]);
+    }
+
+    beginLcdFrame();
+    for (int y = top; y <= bottom; y++) {
+        int x0, x1;
+        if (polygonSpan(xs, ys, count, y, x0, x1)) lcdSpan(x0, y, x1 - x0 + 1, color);
+    }
+    endLcdFrame();
+}
+
+void fillCapsule(const Capsule &capsule, uint16_t color) {
+    beginLcdFrame();
+    for (int y = capsule.minY; y <= capsule.maxY; y++) {
+        int x0, x1;
+        if (capsuleSpan(capsule, y, x0, x1)) lcdSpan(x0, y, x1 - x0 + 1, color);
+    }
+    endLcdFrame();
+}
+
+void fillCircleSpans(int x, int y, int r, uint16_t color) {
+    beginLcdFrame();
+    for (int dy = -r; dy <= r; dy++) {
+        int hw = circleHalfWidth(r, dy);
+        lcdSpan(x - hw, y + dy, 2 * hw + 1, color);
+    }
+    endLcdFrame();
+}
+
+// Runs of an outlined disc on row dy: outer extent, and the inner disc's
+// half-width or -1 where the ring covers the whole row
+static void outlinedRow(int r, int dy, int &outer, int &inner) {
+    outer = circleHalfWidth(r + 1, dy);
+    inner = circleHalfWidth(r, dy);
+}
+
+void fillCircleOutlined(int x, int y, int r, uint16_t color, uint16_t outline) {
+    beginLcdFrame();
+    for (int dy = -r - 1; dy <= r + 1; dy++) {
+        int outer, inner;
+        outlinedRow(r, dy, outer, inner);
+        if (inner < 0) {
+            lcdSpan(x - outer, y + dy, 2 * outer + 1, outline);
+            continue;
+        }
+        // Contiguous, so lcd_batch sends the three as one run
+        lcdSpan(x - outer, y + dy, outer - inner, outline);
+        lcdSpan(x - inner, y + dy, 2 * inner + 1, color);
+        lcdSpan(x + inner + 1, y + dy, outer - inner, outline);
+    }
+    endLcdFrame();
+}
+
+void tileFill(RasterTile &tile, uint16_t color) {
+    uint16_t swapped = (color >> 8) | (color << 8);
+    for (int i = 0; i < tile.w * tile.h; i++) tile.pixels[i] = swapped;
+}
+
+void tileSpan(RasterTile &tile, int x0, int x1, int y, uint16_t color) {
+    if (y < tile.y || y >= tile.y + tile.h) return;
+    x0 = max(x0, (int)tile.x);
+    x1 = min(x1, tile.x + tile.w - 1);
+    uint16_t swapped = (color >> 8) | (color << 8);
+    uint16_t *row = tile.pixels + (y - tile.y) * tile.w - tile.x;
+    for (int x = x0; x <= x1; x++) row[x] = swapped;
+}
+
+void tileLine(RasterTile &tile, int x0, int y0, int x1, int y1, uint16_t color) {
+    // Bresenham with the steep and direction swaps the LCD library makes,
+    // so the restored pixels are the ones it drew
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) {
+        int t = x0; x0 = y0; y0 = t;
+        t = x1; x1 = y1; y1 = t;
+    }
+    if (x0 > x1) {
+        int t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    int dx = x1 - x0;
+    int dy = abs(y1 - y0);
+    int err = dx >> 1;
+    int ystep = y0 < y1 ? 1 : -1;
+    for (; x0 <= x1; x0++) {
+        if (steep) {
+            tileSpan(tile, y0, y0, x0, color);
+        } else {
+            tileSpan(tile, x0, x0, y0, color);
+        }
+        err -= dy;
+        if (err < 0) {
+            err += dx;
+            y0 += ystep;
+        }
+    }
+}
+
+void tileCircleOutlined(RasterTile &tile, int x, int y, int r, uint16_t color, uint16_t outline) {
+    for (int dy = -r - 1; dy <= r + 1; dy++) {
+        int outer, inner;
+        outlinedRow(r, dy, outer, inner);
+        tileSpan(tile, x - outer, x + outer, y + dy, outline);
+        if (inner >= 0) tileSpan(tile, x - inner, x + inner, y + dy, color);
+    }
+}
+
+void pushTileCircle(const RasterTile &tile, int x, int y, int r) {
+    beginLcdFrame();
+    for (int dy = -r; dy <= r; dy++) {
+        int row = y + dy;
+        if (row < tile.y || row >= tile.y + tile.h) continue;
+        int hw = circleHalfWidth(r, dy);
+        int x0 = max(x - hw, (int)tile.x);
+        int x1 = min(x + hw, tile.x + tile.w - 1);
+        if (x0 > x1) continue;
+        lcdPixels(x0, row, x1 - x0 + 1, tile.pixels + (row - tile.y) * tile.w + (x0 - tile.x));
+    }
+    endLcdFrame();
+}
@@ -0,0 +1,72 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <M5Stack.h>
+
+// Scan conversion of convex shapes into one horizontal span per row, so a
+// shape is drawn with a single write per scanline and no pixel twice.
+// Coordinates are pixel centres. The span functions only do the geometry;
+// the fill functions send the spans through lcd_batch.
+
+// Floor, round-half-up and ceil of n / d, for d > 0
+inline int divFloor(int n, int d) {
+    return n >= 0 ? n / d : -((-n + d - 1) / d);
+}
+
+inline int divRound(int n, int d) {
+    return divFloor(2 * n + d, 2 * d);
+}
+
+inline int divCeil(int n, int d) {
+    return n >= 0 ? (n + d - 1) / d : n / d;
+}
+
+// Half-width of a filled circle dy rows from its centre, -1 outside it.
+// Radii the games draw every frame come from tables.
+int circleHalfWidth(int r, int dy);
+
+// Half-widths for rows 0..r below the centre, or NULL if r has no table
+const uint8_t *circleSpanTable(int r);
+
+// Columns a convex polygon covers on row y; false if it misses the row
+bool polygonSpan(const int16_t *xs, const int16_t *ys, int count, int y, int &x0, int &x1);
+
+// Two discs and the band joining them: a thick line with round caps, or
+// with different radii, a tapered one like a flipper. Built once, then
+// spanned row by row.
+struct Capsule {
+    int16_t x0, y0, r0;
+    int16_t x1, y1, r1;
+    int16_t bandX[4], bandY[4];    // Quad between the discs' sides
+    int16_t minY, maxY;
+};
+
+void initCapsule(Capsule &capsule, int x0, int y0, int r0, int x1, int y1, int r1);
+bool capsuleSpan(const Capsule &capsule, int y, int &x0, int &x1);
+
+void fillPolygon(const int16_t *xs, const int16_t *ys, int count, uint16_t color);
+void fillCapsule(const Capsule &capsule, uint16_t color);
+void fillCircleSpans(int x, int y, int r, uint16_t color);
+
+// Disc of radius r inside a ring out to r + 1, each row sent as one run
+void fillCircleOutlined(int x, int y, int r, uint16_t color, uint16_t outline);
+
+// Small off-screen image for composing what lies under a moving sprite.
+// Pixels are in the byte order pushImage takes, like lcdPixels.
+struct RasterTile {
+    int16_t x, y, w, h;        // Screen rect the tile covers
+    uint16_t *pixels;
+};
+
+void tileFill(RasterTile &tile, uint16_t color);
+void tileSpan(RasterTile &tile, int x0, int x1, int y, uint16_t color);
+
+// Same pixels as M5.Lcd.drawLine, clipped to the tile
+void tileLine(RasterTile &tile, int x0, int y0, int x1, int y1, uint16_t color);
+
+void tileCircleOutlined(RasterTile &tile, int x, int y, int r, uint16_t color, uint16_t outline);
+
+// Copy a disc of the tile back to the screen: a save-under restore
+void pushTileCircle(const RasterTile &tile, int x, int y, int r);
+
+#endif
@@ -0,0 +1,356 @@
+#include "screen_capture.h"
+
+#if SCREEN_CAPTURE
+#include <SD.h>
+#include <atomic>
+
+#define LCD_WIDTH 320
+#define LCD_HEIGHT 240
+
+static File file;
+static bool active = false;
+static CaptureStats stats;
+
+// The game fills one buffer while the writer empties the other
+static uint8_t buffers[2][CAPTURE_BUFFER_BYTES];
+static int fillIndex;
+static int fillBytes;
+static std::atomic<int> queuedIndex(0);
+static std::atomic<int> queuedBytes(0);    // 0 when the writer is free
+
+static TaskHandle_t writerTask = NULL;
+static std::atomic<bool> stopRequested(false);
+static std::atomic<bool> writerFinished(true);
+
+// This frame's share of the budget
+static uint32_t frameMicros;
+static bool dropping;          // Rest of this frame is being dropped
+static bool gap;               // Something was dropped since the last marker
+
+// Rows drawn outside the capture, waiting to be read back
+static bool batchedGame;
+static uint32_t dirty[(LCD_HEIGHT + 31) / 32];
+static int readY;              // Where the next frame's read back starts
+static uint16_t rowPixels[LCD_WIDTH];
+
+static void writerMain(void *) {
+    while (!stopRequested.load()) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int bytes = queuedBytes.load();
+        if (bytes == 0) continue;
+
+        uint32_t start = micros();
+        file.write(buffers[queuedIndex.load()], bytes);
+        stats.writeMicros += micros() - start;
+        queuedBytes.store(0);
+    }
+    writerFinished.store(true);
+    vTaskDelete(NULL);
+}
+
+// Give the filled buffer to the writer and start on the other one. False
+// if the writer is still busy with the last one.
+static bool handOff() {
+    if (queuedBytes.load() != 0) return false;
+    if (fillBytes == 0) return true;
+
+    queuedIndex.store(fillIndex);
+    queuedBytes.store(fillBytes);
+    xTaskNotifyGive(writerTask);
+    stats.bytes += fillBytes;
+    fillIndex ^= 1;
+    fillBytes = 0;
+    return true;
+}
+
+static void markRows(int y, int h) {
+    for (int row = y; row < y + h; row++) dirty[row / 32] |= 1UL << (row % 32);
+}
+
+static bool rowDirty(int y) {
+    return dirty[y / 32] & (1UL << (y % 32));
+}
+
+static bool anyDirty() {
+    for (uint32_t rows : dirty) {
+        if (rows) return true;
+    }
+    return false;
+}
+
+// What was lost could be anywhere, so the whole panel is read back
+static void markGap() {
+    gap = true;
+    markRows(0, LCD_HEIGHT);
+}
+
+static void drop() {
+    stats.dropped++;
+    dropping = true;
+    markGap();
+}
+
+// Room for a record that can wait if there is none: unlike reserve, no
+// room isn't a loss
+static uint8_t *room(int bytes) {
+    if (dropping || (fillBytes + bytes > CAPTURE_BUFFER_BYTES && !handOff())) return NULL;
+    uint8_t *out = buffers[fillIndex] + fillBytes;
+    fillBytes += bytes;
+    return out;
+}
+
+// Room for a record of the given size, or NULL if it's dropped
+static uint8_t *reserve(int bytes) {
+    if (dropping) {
+        stats.dropped++;
+        return NULL;
+    }
+    if (bytes > CAPTURE_BUFFER_BYTES ||
+        (fillBytes + bytes > CAPTURE_BUFFER_BYTES && !handOff())) {
+        drop();
+        return NULL;
+    }
+    uint8_t *out = buffers[fillIndex] + fillBytes;
+    fillBytes += bytes;
+    return out;
+}
+
+static uint8_t *put16(uint8_t *out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    return out + 2;
+}
+
+static uint8_t *putSpan(uint8_t *out, char tag, int x, int y, int w) {
+    *out++ = tag;
+    out = put16(out, x);
+    *out++ = y;
+    return put16(out, w);
+}
+
+static void charge(uint32_t start) {
+    uint32_t spent = micros() - start;
+    frameMicros += spent;
+    stats.micros += spent;
+    if (frameMicros > CAPTURE_BUDGET_US && !dropping) {
+        // Keep what's in, lose the rest of the frame
+        dropping = true;
+        markGap();
+    }
+}
+
+// A span of the panel as an S or P record at out, which has room for the
+// P record. Returns the record's size.
+static int readSpan(uint8_t *out, int x, int y, int w) {
+    // Read into an aligned buffer: the record can start on any byte
+    M5.Lcd.readRect(x, y, w, 1, rowPixels);
+    stats.readRows++;
+    bool solid = true;
+    for (int i = 1; i < w && solid; i++) solid = rowPixels[i] == rowPixels[0];
+
+    uint8_t *pixels = putSpan(out, solid ? CAPTURE_SOLID : CAPTURE_PIXELS, x, y, w);
+    if (solid) {
+        put16(pixels, (rowPixels[0] >> 8) | (rowPixels[0] << 8));
+        return 8;
+    }
+    memcpy(pixels, rowPixels, w * 2);
+    return 6 + w * 2;
+}
+
+// Up to CAPTURE_READ_ROWS waiting rows, in order from where the last frame
+// stopped, or the next row when none are waiting. A row there's no room
+// for waits for the next frame.
+static void readBackRows() {
+    uint32_t start = micros();
+    bool waiting = anyDirty();
+    int read = 0;
+    for (int n = 0; n < LCD_HEIGHT && read < (waiting ? CAPTURE_READ_ROWS : 1); n++) {
+        int y = readY;
+        if (waiting && !rowDirty(y)) {
+            readY = (readY + 1) % LCD_HEIGHT;
+            continue;
+        }
+        // Only into the first half of a buffer: rows that crowded out the
+        // frame's own records would be lost, and a loss has the whole
+        // panel read back again
+        int bytes = 2 + 6 + LCD_WIDTH * 2;
+        if (fillBytes + bytes > CAPTURE_BUFFER_BYTES / 2 && !handOff()) break;
+        uint8_t *out = room(bytes);
+        if (!out) break;
+        if (read == 0) M5.Lcd.endWrite();     // As captureRect does
+
+        out[0] = CAPTURE_READ;
+        out[1] = y;
+        fillBytes -= bytes - 2 - readSpan(out + 2, 0, y, LCD_WIDTH);
+        dirty[y / 32] &= ~(1UL << (y % 32));
+        readY = (readY + 1) % LCD_HEIGHT;
+        read++;
+    }
+    uint32_t spent = micros() - start;
+    stats.readMicros += spent;
+    stats.micros += spent;
+}
+
+bool startCapture(const char *name, bool batched) {
+    stopCapture();
+
+    char path[48];
+    snprintf(path, sizeof(path), "%s/%s.cap", CAPTURE_DIR, name);
+    SD.mkdir(CAPTURE_DIR);
+    file = SD.open(path, FILE_WRITE);
+    if (!file) {
+        Serial.printf("Capture: can't write %s\n", path);
+        return false;
+    }
+
+    // Header, then the screen as it is now, one image run per row
+    uint8_t header[10];
+    memcpy(header, CAPTURE_MAGIC, 6);
+    put16(put16(header + 6, LCD_WIDTH), LCD_HEIGHT);
+    file.write(header, sizeof(header));
+
+    uint8_t *row = buffers[0];
+    for (int y = 0; y < LCD_HEIGHT; y++) {
+        uint8_t *pixels = putSpan(row, CAPTURE_PIXELS, 0, y, LCD_WIDTH);
+        M5.Lcd.readRect(0, y, LCD_WIDTH, 1, (uint16_t *)pixels);
+        file.write(row, pixels - row + LCD_WIDTH * 2);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    fillIndex = 0;
+    fillBytes = 0;
+    queuedBytes.store(0);
+    frameMicros = 0;
+    dropping = false;
+    gap = false;
+    batchedGame = batched;
+    memset(dirty, 0, sizeof(dirty));
+    readY = 0;
+
+    stopRequested.store(false);
+    writerFinished.store(false);
+    if (xTaskCreatePinnedToCore(writerMain, "capture", CAPTURE_TASK_STACK, NULL,
+                                CAPTURE_TASK_PRIORITY, &writerTask,
+                                CAPTURE_TASK_CORE) != pdPASS) {
+        writerTask = NULL;
+        writerFinished.store(true);
+        file.close();
+        return false;
+    }
+    active = true;
+    return true;
+}
+
+void stopCapture() {
+    if (!active) return;
+
+    // The last frame gets a marker, and its flags, like any other
+    captureFrame();
+    active = false;
+
+    // Flush both buffers, then let the writer go
+    while (!handOff()) delay(1);
+    while (queuedBytes.load() != 0) delay(1);
+    stopRequested.store(true);
+    xTaskNotifyGive(writerTask);
+    while (!writerFinished.load()) delay(1);
+    writerTask = NULL;
+    file.close();
+}
+
+bool capturing() {
+    return active;
+}
+
+const CaptureStats &captureStats() {
+    return stats;
+}
+
+void captureFrame() {
+    stats.peakMicros = max(stats.peakMicros, frameMicros);
+    frameMicros = 0;
+    dropping = false;
+    stats.frames++;
+
+    // The rows go before the marker: they're the screen as the last pass
+    // left it, which is the frame the marker ends
+    if (!batchedGame) markRows(0, LCD_HEIGHT);
+    readBackRows();
+
+    uint32_t start = micros();
+    uint8_t *out = reserve(6);
+    if (out) {
+        uint32_t now = millis();
+        *out++ = CAPTURE_FRAME;
+        out = put16(put16(out, now & 0xFFFF), now >> 16);
+        *out = (gap ? CAPTURE_GAP : 0) | (anyDirty() ? CAPTURE_STALE : 0);
+        gap = false;
+    }
+    charge(start);
+}
+
+void captureRect(int x, int y, int w, int h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    w = min(w, LCD_WIDTH - x);
+    h = min(h, LCD_HEIGHT - y);
+    if (w <= 0 || h <= 0) return;
+
+    // Read back in place if it fits this frame, so the records keep their
+    // order; otherwise the rows wait for captureFrame
+    if (dropping || h * (6 + w * 2) > CAPTURE_BUFFER_BYTES) {
+        markRows(y, h);
+        return;
+    }
+    // readRect leaves CS high even inside a transaction, so end it first;
+    // lcd_batch takes the bus again for its next run
+    uint32_t start = micros();
+    M5.Lcd.endWrite();
+    for (int row = y; row < y + h; row++) {
+        uint8_t *out = room(6 + w * 2);
+        if (!out) {
+            markRows(row, y + h - row);
+            break;
+        }
+        fillBytes -= 6 + w * 2 - readSpan(out, x, row, w);
+    }
+    uint32_t spent = micros() - start;
+    stats.readMicros += spent;
+    stats.micros += spent;
+}
+
+void captureRun(int x, int y, int w, const uint16_t *pixels) {
+    uint32_t start = micros();
+    bool solid = true;
+    for (int i = 1; i < w && solid; i++) solid = pixels[i] == pixels[0];
+
+    uint8_t *out = reserve(solid ? 8 : 6 + w * 2);
+    if (out) {
+        out = putSpan(out, solid ? CAPTURE_SOLID : CAPTURE_PIXELS, x, y, w);
+        if (solid) {
+            put16(out, (pixels[0] >> 8) | (pixels[0] << 8));
+        } else {
+            memcpy(out, pixels, w * 2);
+        }
+    }
+    charge(start);
+}
+
+void captureWindow(int x, int y, int w, int h) {
+    uint32_t start = micros();
+    uint8_t *out = reserve(7);
+    if (out) *putSpan(out, CAPTURE_WINDOW, x, y, w) = h;
+    charge(start);
+}
+
+void captureStream(const uint16_t *pixels, int count) {
+    uint32_t start = micros();
+    uint8_t *out = reserve(3 + count * 2);
+    if (out) {
+        *out++ = CAPTURE_STREAM;
+        memcpy(put16(out, count), pixels, count * 2);
+    }
+    charge(start);
+}
+
+#endif
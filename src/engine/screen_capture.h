@@ -0,0 +1,105 @@
+#ifndef SCREEN_CAPTURE_H
+#define SCREEN_CAPTURE_H
+
+#include <M5Stack.h>
+
+// Gameplay recording to SD. Rather than whole frames, the capture keeps
+// what lcd_batch sends the panel: frame markers, solid runs, image runs
+// and streamed windows, appended to one file. tools/capture_frames.py
+// replays the file onto a screen and writes out the frames.
+//
+// Records are packed into one of two buffers while the game draws; a full
+// buffer goes to a writer task on core 0, which writes it out while the
+// game fills the other. SD shares the bus with the panel, so the writes
+// land between the game's frames. Capture time per frame is capped at
+// CAPTURE_BUDGET_US: past that, or when both buffers are full, the rest of
+// the frame is dropped and the next frame is marked as having a gap.
+//
+// The file starts from a copy of the screen, so a title drawn in setup is
+// in it. Anything drawn later outside lcd_batch is read back off the
+// panel: a small box as soon as captureRect reports it, anything bigger a
+// few rows a frame. A game that draws straight to M5.Lcd throughout is
+// read back a few rows every frame. A gap marks the whole panel to be
+// read back, which is the capture's keyframe, and with nothing waiting
+// one row a frame is read anyway, so the whole panel is re-read every
+// LCD_HEIGHT quiet frames. Frames with rows still waiting are marked
+// stale.
+//
+// With SCREEN_CAPTURE 0 none of this is built, and the hooks are empty
+// inlines.
+
+#ifndef SCREEN_CAPTURE
+#define SCREEN_CAPTURE 0       // Record games to SD as they're played
+#endif
+
+#define CAPTURE_DIR "/capture"
+#define CAPTURE_BUFFER_BYTES 16384    // A pass of pinball, HUD and launch prompt, is about 11 KB
+#define CAPTURE_BUDGET_US 400          // Capture time allowed per frame, reads aside
+#define CAPTURE_READ_ROWS 4            // Rows read back off the panel per frame
+#define CAPTURE_TASK_CORE 0
+#define CAPTURE_TASK_PRIORITY 1
+#define CAPTURE_TASK_STACK 4096
+
+// Record tags. All fields little endian; x and w are 16 bits, y and h 8.
+// Pixels are RGB565 in pushImage byte order, as lcd_batch sends them.
+#define CAPTURE_MAGIC "M5CAP1"         // Then width and height, 16 bits each
+#define CAPTURE_FRAME 'F'              // millis (32), flags (8)
+#define CAPTURE_SOLID 'S'              // x, y, w, colour (16, RGB565)
+#define CAPTURE_PIXELS 'P'             // x, y, w, then w pixels
+#define CAPTURE_WINDOW 'W'             // x, y, w, h; STREAM records fill it
+#define CAPTURE_STREAM 'D'             // count (16), then count pixels
+#define CAPTURE_READ 'R'               // y; the next record, S or P, is that
+                                       // whole row read back off the panel
+#define CAPTURE_GAP 0x01               // Frame flag: records before it were lost
+#define CAPTURE_STALE 0x02             // Frame flag: rows drawn outside the
+                                       // capture are still to be read back
+
+#if SCREEN_CAPTURE
+
+// Totals since capture started
+struct CaptureStats {
+    uint32_t frames;
+    uint32_t bytes;            // Handed to the writer
+    uint32_t dropped;          // Records lost to the budget or full buffers
+    uint32_t micros;           // Spent recording, on the game's core
+    uint32_t peakMicros;       // Most in one frame
+    uint32_t writeMicros;      // Spent by the writer task
+    uint32_t readRows;         // Rows read back off the panel, boxes included
+    uint32_t readMicros;       // Spent reading them, not charged to the budget
+};
+
+// Open CAPTURE_DIR/<name>.cap and copy the screen into it. A batched game
+// reports what it draws outside lcd_batch with captureRect; any other has
+// the whole panel read back, CAPTURE_READ_ROWS a frame.
+bool startCapture(const char *name, bool batched);
+
+// End the last frame, write out what's buffered and close the file
+void stopCapture();
+
+bool capturing();
+const CaptureStats &captureStats();
+
+// Called by main before each pass of the game's loop
+void captureFrame();
+
+// The box was drawn straight to M5.Lcd. Call once the drawing is done;
+// the panel's transaction is ended to read it back.
+void captureRect(int x, int y, int w, int h);
+
+// Called by lcd_batch
+void captureRun(int x, int y, int w, const uint16_t *pixels);
+void captureWindow(int x, int y, int w, int h);
+void captureStream(const uint16_t *pixels, int count);
+
+#else
+
+inline bool capturing() { return false; }
+inline void captureFrame() {}
+inline void captureRect(int, int, int, int) {}
+inline void captureRun(int, int, int, const uint16_t *) {}
+inline void captureWindow(int, int, int, int) {}
+inline void captureStream(const uint16_t *, int) {}
+
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#include "title_screen.h"
+
+void startTitle(TitleScreen &title, uint16_t duration, uint8_t pressed) {
+    title.start = millis();
+    title.duration = duration;
+    title.held = pressed;
+    title.skipped = 0;
+}
+
+bool updateTitle(TitleScreen &title, uint8_t pressed, bool warmed) {
+    // A button that opened the title has to come up before it can skip it
+    title.held &= pressed;
+    title.skipped |= pressed & ~title.held;
+
+    if (!warmed) return false;
+    return title.skipped || millis() - title.start >= title.duration;
+}
+
+bool titleSliceLeft(uint32_t sliceStart) {
+    return millis() - sliceStart < TITLE_SLICE_MS;
+}
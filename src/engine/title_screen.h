@@ -0,0 +1,30 @@
+#ifndef TITLE_SCREEN_H
+#define TITLE_SCREEN_H
+
+#include <M5Stack.h>
+
+// Title and instruction screens that don't block. A game draws its title,
+// calls startTitle, and then keeps calling updateTitle from its loop,
+// spending the passes in between on warm-up work (tables, level data) in
+// slices of about TITLE_SLICE_MS. The title closes when its time runs out
+// or on a fresh button press, but not before the warm-up has finished.
+
+#define TITLE_SLICE_MS 8
+
+struct TitleScreen {
+    uint32_t start;
+    uint16_t duration;
+    uint8_t held;              // Buttons down at the start, ignored until released
+    uint8_t skipped;           // Buttons that closed the title, 0 if it timed out
+};
+
+// pressed is the mask of buttons down right now, set bits held
+void startTitle(TitleScreen &title, uint16_t duration, uint8_t pressed);
+
+// True once the title should close; warmed says the game's warm-up is done
+bool updateTitle(TitleScreen &title, uint8_t pressed, bool warmed);
+
+// True while a warm-up slice that began at sliceStart has time left
+bool titleSliceLeft(uint32_t sliceStart);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer triple buffer. The writer
+// fills back() and publishes it; the reader picks up the newest published
+// state with update() and reads front(). Neither side ever waits, so a slow
+// reader only skips states and a slow writer only repeats them.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : backIndex(0), frontIndex(2), middle(1) {}
+
+    // Writer side
+    T &back() { return buffers[backIndex]; }
+
+    void publish() {
+        uint32_t prev = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = prev & INDEX_MASK;
+    }
+
+    // Reader side. Returns true if a newer state was picked up.
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) {
+            return false;
+        }
+        uint32_t prev = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = prev & INDEX_MASK;
+        return true;
+    }
+
+    const T &front() const { return buffers[frontIndex]; }
+
+private:
+    static const uint32_t INDEX_MASK = 0x3;
+    static const uint32_t FRESH = 0x4;
+
+    T buffers[3];
+    uint32_t backIndex;            // Owned by the writer
+    uint32_t frontIndex;           // Owned by the reader
+    std::atomic<uint32_t> middle;  // Shared slot index plus FRESH flag
+};
+
+#endif
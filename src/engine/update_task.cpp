@@ -0,0 +1,48 @@
+#include "update_task.h"
+#include <atomic>
+
+static TaskHandle_t updateTask = NULL;
+static UpdateStep taskStep = NULL;
+static uint32_t taskPeriodMs = 20;
+static std::atomic<bool> stopRequested(false);
+static std::atomic<bool> taskFinished(true);
+
+static void updateTaskMain(void *) {
+    TickType_t wake = xTaskGetTickCount();
+    while (!stopRequested.load()) {
+        taskStep();
+        // Fixed rate: an overrun step is followed immediately by the next
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(taskPeriodMs));
+    }
+    taskFinished.store(true);
+    vTaskDelete(NULL);
+}
+
+void startUpdateTask(UpdateStep step, uint32_t periodMs) {
+    stopUpdateTask();
+
+    taskStep = step;
+    taskPeriodMs = periodMs;
+    stopRequested.store(false);
+    taskFinished.store(false);
+    if (xTaskCreatePinnedToCore(updateTaskMain, "update", UPDATE_TASK_STACK, NULL,
+                                UPDATE_TASK_PRIORITY, &updateTask,
+                                UPDATE_TASK_CORE) != pdPASS) {
+        updateTask = NULL;
+        taskFinished.store(true);
+    }
+}
+
+void stopUpdateTask() {
+    if (updateTask == NULL) return;
+
+    stopRequested.store(true);
+    while (!taskFinished.load()) {
+        delay(1);
+    }
+    updateTask = NULL;
+}
+
+bool updateTaskRunning() {
+    return updateTask != NULL;
+}
@@ -0,0 +1,23 @@
+#ifndef UPDATE_TASK_H
+#define UPDATE_TASK_H
+
+#include <M5Stack.h>
+
+// Runs a game's update step in its own FreeRTOS task on core 0 at a fixed
+// rate, leaving the Arduino loop on core 1 free to render. Only one update
+// task runs at a time.
+
+#define UPDATE_TASK_CORE 0
+#define UPDATE_TASK_PRIORITY 2
+#define UPDATE_TASK_STACK 4096
+
+typedef void (*UpdateStep)();
+
+void startUpdateTask(UpdateStep step, uint32_t periodMs);
+
+// Blocks until the current step has finished and the task is gone
+void stopUpdateTask();
+
+bool updateTaskRunning();
+
+#endif
@@ -1,4 +1,7 @@
 #include "game1_platform.h"
+#include "../engine/title_screen.h"
+#include "../engine/arena.h"
+#include "../engine/lcd_batch.h"
 #include <Wire.h>
 
 // Game constants
@@ -9,6 +12,8 @@
 #define MOVE_SPEED 3.0
 #define RUN_SPEED 6.0
 #define PLAYER_SIZE 12
+#define MAX_PLATFORMS 8
+#define TITLE_MS 2000
 
 // Custom colors
 #define TFT_BROWN 0x79E0
@@ -33,10 +38,12 @@ struct Platform {
 };
 
 static Player player;
-static Platform platforms[8];
+static Platform *platforms;     // MAX_PLATFORMS, in the arena
 static int platformCount = 0;
 static bool needsFullRedraw = true;
 static uint8_t facesData = 0xFF;
+static TitleScreen title;
+static bool inTitle = false;
 
 static void readFacesButtons() {
     Wire.requestFrom(FACES_ADDR, 1);
@@ -185,12 +192,27 @@ void game1Setup() {
     M5.Lcd.setTextSize(1);
     M5.Lcd.setCursor(10, 130);
     M5.Lcd.println("D-Pad:Move A/UP:Jump B:Run");
-    delay(2000);
 
+    platforms = arenaArray<Platform>(MAX_PLATFORMS);
+
+    // Nothing to warm up here; the level is a handful of rects
     setupGameState();
+    readFacesButtons();
+    startTitle(title, TITLE_MS, ~facesData);
+    inTitle = true;
+}
+
+void game1Teardown() {
+    platforms = NULL;
 }
 
 void game1Loop() {
+    if (inTitle) {
+        readFacesButtons();
+        if (!updateTitle(title, ~facesData, true)) return;
+        inTitle = false;
+    }
+
     if (needsFullRedraw) {
         M5.Lcd.fillScreen(TFT_SKYBLUE);
         M5.Lcd.setTextSize(1);
@@ -202,6 +224,7 @@ void game1Loop() {
     }
 
     updatePlayer();
+    beginLcdFrame();
     erasePlayer(player.lastX, player.lastY);
 
     for (int i = 0; i < platformCount; i++) {
@@ -216,5 +239,6 @@ void game1Loop() {
     }
 
     drawPlayer();
-    delay(20);
+    endLcdFrame();
+    delay(GAME1_FRAME_MS);
 }
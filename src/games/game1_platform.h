@@ -3,7 +3,10 @@
 
 #include <M5Stack.h>
 
+#define GAME1_FRAME_MS 20     // What the loop paces itself to
+
 void game1Setup();
 void game1Loop();
+void game1Teardown();
 
 #endif
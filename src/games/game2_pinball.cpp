@@ -1,5 +1,16 @@
 #include "game2_pinball.h"
+#include "game2_pinball_table.h"
+#include "game2_pinball_sdf.h"
+#include "../engine/triple_buffer.h"
+#include "../engine/update_task.h"
+#include "../engine/title_screen.h"
+#include "../engine/arena.h"
+#include "../engine/lcd_batch.h"
+#include "../engine/raster.h"
+#include "../engine/font_cache.h"
+#include "../engine/screen_capture.h"
 #include <Wire.h>
+#include <atomic>
 
 // Faces GameBoy I2C address
 #define FACES_ADDR 0x08
@@ -8,51 +19,117 @@
 #define SCREEN_WIDTH 320
 #define SCREEN_HEIGHT 240
 #define BALL_RADIUS 4
+#define MAX_BALLS 8
+#define MULTIBALL_SCORE 2000   // Extra balls awarded every this many points
+#define MULTIBALL_EXTRA 2
 #define GRAVITY 0.3
-#define BOUNCE_DAMPING 0.85
-#define FLIPPER_SPEED 15.0
+#define FLIPPER_SPEED 15.0     // Degrees per tick
+#define FLIPPER_LENGTH 40
+#define FLIPPER_RADIUS 3       // Half thickness of the blade
+#define FLIPPER_RESTITUTION 0.7
+#define FLIPPER_COLOR TFT_YELLOW
+#define SUBSTEP_DIST (BALL_RADIUS / 2.0)  // Max distance a ball moves per collision sub-step
+#define MAX_SUBSTEPS 16        // Most a ball at MAX_BALL_SPEED needs; see below
+#define TABLE_SDF 1            // 0 tests static geometry exactly through the BVH
+#define PHYSICS_TASK 1         // Step physics on core 0, render snapshots on core 1
+#define PHYSICS_PERIOD_MS 20
+#define TICK_SCALE (PHYSICS_PERIOD_MS / 20.0)  // Speeds above are tuned per 20 ms tick
+#define MAX_BALL_SPEED 20.0    // Per-tick speed a ball is slowed to after a step
+#ifndef BALL_SPEED_CAP
+#define BALL_SPEED_CAP 1       // 0 leaves speed unlimited, for the fuzzer
+#endif
+
+// A ball closing on something at the cap, plus a tick of gravity, plus a
+// blade tip swinging the other way, still moves half its radius at most
+// per sub-step. The step count follows the speed and stops at
+// MAX_SUBSTEPS, which bounds what a tick costs; with the cap on, no ball
+// gets that far.
+#define FLIPPER_TIP_SPEED (FLIPPER_SPEED * PI / 180.0 * FLIPPER_LENGTH)
+static_assert(MAX_SUBSTEPS >=
+                  1 + (int)((MAX_BALL_SPEED + GRAVITY + FLIPPER_TIP_SPEED) * TICK_SCALE / SUBSTEP_DIST),
+              "MAX_SUBSTEPS too small for MAX_BALL_SPEED");
+#define TITLE_MS 2500
+#define REDRAW_ROWS 4          // Rows composed at a time for a full redraw
+
+// Input bits above the Faces byte
+#define INPUT_BTN_A 0x100
+#define INPUT_BTN_C 0x200
 
 // Custom colors
 #define TFT_DARKGREEN 0x0320
 
-// Ball structure
-struct Ball {
-    float x, y;
-    float lastX, lastY;
-    float vx, vy;
-    bool active;
-    uint16_t color;
+// Ball storage, kept as parallel arrays so each physics pass is a tight
+// loop over plain floats. Balls in play are packed into [0, count).
+struct Balls {
+    float x[MAX_BALLS], y[MAX_BALLS];
+    float vx[MAX_BALLS], vy[MAX_BALLS];
+    uint16_t color[MAX_BALLS];
+    uint8_t order[MAX_BALLS];   // Indices sorted by x for the sweep
+    int count;
+};
+
+const uint16_t BALL_COLORS[MAX_BALLS] = {
+    TFT_WHITE, TFT_YELLOW, TFT_CYAN, TFT_MAGENTA,
+    TFT_ORANGE, TFT_GREENYELLOW, TFT_PINK, TFT_LIGHTGREY
 };
 
 // Flipper structure
 struct Flipper {
     float x, y;
     float angle;
-    float lastAngle;
+    float prevAngle;           // Angle at the start of the current step
     float targetAngle;
+    float angularVelocity;     // Radians per tick, positive turns counter-clockwise
     bool isLeft;
     uint16_t color;
 };
 
-// Bumper structure
-struct Bumper {
-    int16_t x, y;
-    int16_t radius;
-    uint16_t color;
-    int value;
+// Blade direction and surface velocity for one whole-degree flipper angle
+struct FlipperAngleStep {
+    float dx, dy;      // Unit vector from pivot to tip
+    float tx, ty;      // Surface velocity per pixel from the pivot per rad/tick
+};
+
+// Immutable view of one physics step, handed to the renderer
+struct PinballSnapshot {
+    int16_t ballX[MAX_BALLS], ballY[MAX_BALLS];
+    uint16_t ballColor[MAX_BALLS];
+    int ballCount;
+    float leftAngle, rightAngle;
+    int score;
+    int lives;
+    bool ballInPlay;
+    bool gameOver;
 };
 
-// Game state
-static Ball ball;
+// Game state, owned by the physics step
+static Balls balls;
 static Flipper leftFlipper, rightFlipper;
-static Bumper bumpers[5];
+static FlipperAngleStep *flipperSteps;   // 181 whole degrees
+static PinballTable *table;
+static TableSDF *tableSDF;
 static int score = 0;
 static int lives = 3;
 static bool gameOver = false;
 static bool ballInPlay = false;
+static unsigned long lastBumperHit = 0;
+static int nextMultiballScore = MULTIBALL_SCORE;
+
+// Shared between the render loop and the physics step
+static TripleBuffer<PinballSnapshot> *snapshots;
+static FontCache *hudFont;
+static uint16_t *redrawStrip;   // SCREEN_WIDTH x REDRAW_ROWS
+static std::atomic<uint32_t> pinballInput(0xFF);
+static std::atomic<bool> launchRequested(false);
+static std::atomic<bool> restartRequested(false);
+
+// Render state
+static PinballSnapshot drawn;   // What is currently on screen
 static bool needsFullRedraw = true;
 static uint8_t facesData = 0xFF;
-static unsigned long lastBumperHit = 0;
+static TitleScreen title;
+static bool inTitle = false;
+static int warmRow;             // Next SDF row to build behind the title
 
 static void readFacesButtons() {
     Wire.requestFrom(FACES_ADDR, 1);
@@ -61,260 +138,457 @@ static void readFacesButtons() {
     }
 }
 
-void resetBall() {
-    ball.x = 300;
-    ball.y = 180;
-    ball.lastX = 300;
-    ball.lastY = 180;
-    ball.vx = 0;
-    ball.vy = 0;
-    ball.active = false;
-    ball.color = TFT_WHITE;
+void resetBalls() {
+    balls.count = 0;
     ballInPlay = false;
 }
 
+static void addBall(float vx, float vy) {
+    if (balls.count >= MAX_BALLS) return;
+
+    int i = balls.count;
+    balls.x[i] = 300;
+    balls.y[i] = 180;
+    balls.vx[i] = vx;
+    balls.vy[i] = vy;
+    balls.color[i] = BALL_COLORS[i];
+    balls.order[i] = i;
+    balls.count++;
+    ballInPlay = true;
+}
+
+// Swap-remove a drained ball, keeping the arrays packed
+static void removeBall(int i) {
+    int last = balls.count - 1;
+    balls.x[i] = balls.x[last];
+    balls.y[i] = balls.y[last];
+    balls.vx[i] = balls.vx[last];
+    balls.vy[i] = balls.vy[last];
+    balls.color[i] = balls.color[last];
+    balls.count--;
+
+    for (int k = 0; k < balls.count; k++) {
+        balls.order[k] = k;
+    }
+}
+
 void launchBall() {
-    if (!ball.active) {
-        ball.vx = -2;
-        ball.vy = -12;
-        ball.active = true;
-        ballInPlay = true;
+    if (balls.count == 0) {
+        addBall(-2, -12);
+    }
+}
+
+// Send extra balls up the launch lane, fanned out so they separate quickly
+static void startMultiball() {
+    for (int n = 0; n < MULTIBALL_EXTRA; n++) {
+        addBall(-2 - (balls.count % 4) * 0.8, -12 + (balls.count % 3));
     }
 }
 
 void setupPinball() {
-    // Initialize ball
-    resetBall();
+    // Initialize balls
+    resetBalls();
 
     // Initialize flippers
-    leftFlipper.x = 80;
-    leftFlipper.y = 220;
+    leftFlipper.x = table->leftFlipperX;
+    leftFlipper.y = table->leftFlipperY;
     leftFlipper.angle = 0;      // Start horizontal/down
-    leftFlipper.lastAngle = 0;
+    leftFlipper.prevAngle = 0;
     leftFlipper.targetAngle = 0;
+    leftFlipper.angularVelocity = 0;
     leftFlipper.isLeft = true;
-    leftFlipper.color = TFT_YELLOW;
+    leftFlipper.color = FLIPPER_COLOR;
 
-    rightFlipper.x = 240;
-    rightFlipper.y = 220;
+    rightFlipper.x = table->rightFlipperX;
+    rightFlipper.y = table->rightFlipperY;
     rightFlipper.angle = 180;   // Start horizontal/down
-    rightFlipper.lastAngle = 180;
+    rightFlipper.prevAngle = 180;
     rightFlipper.targetAngle = 180;
+    rightFlipper.angularVelocity = 0;
     rightFlipper.isLeft = false;
-    rightFlipper.color = TFT_YELLOW;
-
-    // Initialize bumpers
-    bumpers[0] = {80, 60, 12, TFT_RED, 100};
-    bumpers[1] = {160, 50, 12, TFT_ORANGE, 100};
-    bumpers[2] = {240, 60, 12, TFT_RED, 100};
-    bumpers[3] = {120, 100, 12, TFT_CYAN, 50};
-    bumpers[4] = {200, 100, 12, TFT_CYAN, 50};
+    rightFlipper.color = FLIPPER_COLOR;
 
     score = 0;
     lives = 3;
     gameOver = false;
-    needsFullRedraw = true;
+    nextMultiballScore = MULTIBALL_SCORE;
 }
 
-void drawBumper(Bumper &b) {
-    M5.Lcd.fillCircle(b.x, b.y, b.radius, b.color);
-    M5.Lcd.drawCircle(b.x, b.y, b.radius + 1, TFT_WHITE);
+// The capsule the physics collides with, one span per row, so the ball
+// touches the blade where it is drawn
+static void flipperShape(Capsule &shape, int x, int y, float angle) {
+    float rad = angle * PI / 180.0;
+    int x2 = x + FLIPPER_LENGTH * cos(rad);
+    int y2 = y - FLIPPER_LENGTH * sin(rad);
+    initCapsule(shape, x, y, FLIPPER_RADIUS, x2, y2, FLIPPER_RADIUS);
 }
 
-void drawFlipper(Flipper &f) {
-    int length = 40;
-    float rad = f.angle * PI / 180.0;
-    int x2 = f.x + length * cos(rad);
-    int y2 = f.y - length * sin(rad);
+void drawFlipper(int x, int y, float angle, uint16_t color) {
+    Capsule shape;
+    flipperShape(shape, x, y, angle);
+    fillCapsule(shape, color);
+}
 
-    // Draw thick flipper
-    for (int i = -2; i <= 2; i++) {
-        M5.Lcd.drawLine(f.x, f.y + i, x2, y2 + i, f.color);
+// Playfield as the full redraw leaves it, the table's walls and pieces
+// over the felt, for the tile's rect
+static void composeBackground(RasterTile &tile) {
+    tileFill(tile, TFT_DARKGREEN);
+
+    uint8_t nearby[MAX_TABLE_PRIMS];
+    int hits = queryTable(*table, tile.x, tile.y, tile.x + tile.w - 1, tile.y + tile.h - 1,
+                          nearby, MAX_TABLE_PRIMS);
+    for (int h = 0; h < hits; h++) {
+        drawTablePrimTile(table->prims[nearby[h]], tile);
     }
-    M5.Lcd.fillCircle(f.x, f.y, 4, f.color);
 }
 
-void eraseBall() {
-    if (ball.lastX != ball.x || ball.lastY != ball.y) {
-        M5.Lcd.fillCircle((int)ball.lastX, (int)ball.lastY, BALL_RADIUS + 1, TFT_DARKGREEN);
+// The whole playfield, composed a strip at a time and sent through
+// lcd_batch, where it goes out as one window
+static void redrawPlayfield() {
+    for (int y = 0; y < 20; y++) lcdSpan(0, y, SCREEN_WIDTH, TFT_BLACK);
+
+    RasterTile tile;
+    tile.x = 0;
+    tile.w = SCREEN_WIDTH;
+    tile.pixels = redrawStrip;
+    for (tile.y = 20; tile.y < SCREEN_HEIGHT; tile.y += REDRAW_ROWS) {
+        tile.h = min(REDRAW_ROWS, SCREEN_HEIGHT - tile.y);
+        composeBackground(tile);
+        for (int row = 0; row < tile.h; row++) {
+            lcdPixels(0, tile.y + row, SCREEN_WIDTH, redrawStrip + row * SCREEN_WIDTH);
+        }
     }
 }
 
-void drawBall() {
-    if (ball.active) {
-        M5.Lcd.fillCircle((int)ball.x, (int)ball.y, BALL_RADIUS, ball.color);
+// Put back what was under each ball rather than flat felt, so table
+// pieces the ball crossed don't need redrawing whole
+void eraseBalls(const PinballSnapshot &snap) {
+    static uint16_t pixels[(2 * BALL_RADIUS + 1) * (2 * BALL_RADIUS + 1)];
+    RasterTile tile;
+    tile.w = 2 * BALL_RADIUS + 1;
+    tile.h = 2 * BALL_RADIUS + 1;
+    tile.pixels = pixels;
+
+    for (int i = 0; i < snap.ballCount; i++) {
+        tile.x = snap.ballX[i] - BALL_RADIUS;
+        tile.y = snap.ballY[i] - BALL_RADIUS;
+        composeBackground(tile);
+        pushTileCircle(tile, snap.ballX[i], snap.ballY[i], BALL_RADIUS);
     }
 }
 
-void eraseFlipper(Flipper &f) {
-    int length = 40;
-    float rad = f.lastAngle * PI / 180.0;
-    int x2 = f.x + length * cos(rad);
-    int y2 = f.y - length * sin(rad);
-
-    for (int i = -3; i <= 3; i++) {
-        M5.Lcd.drawLine(f.x, f.y + i, x2, y2 + i, TFT_DARKGREEN);
+void drawBalls(const PinballSnapshot &snap) {
+    for (int i = 0; i < snap.ballCount; i++) {
+        fillCircleSpans(snap.ballX[i], snap.ballY[i], BALL_RADIUS, snap.ballColor[i]);
     }
-    M5.Lcd.fillCircle(f.x, f.y, 5, TFT_DARKGREEN);
 }
 
-void updateFlippers() {
-    bool facesLeft = !(facesData & 0x04);
-    bool facesRight = !(facesData & 0x08);
-    bool facesA = !(facesData & 0x10);
+// Spans are exact, so the same shape covers everything the draw wrote
+void eraseFlipper(int x, int y, float angle) {
+    drawFlipper(x, y, angle, TFT_DARKGREEN);
+}
+
+// Turn a flipper toward its target at FLIPPER_SPEED
+static void moveFlipper(Flipper &f) {
+    f.prevAngle = f.angle;
+    float stepAngle = FLIPPER_SPEED * TICK_SCALE;
+    if (f.angle < f.targetAngle) {
+        f.angle = min(f.angle + stepAngle, f.targetAngle);
+    } else if (f.angle > f.targetAngle) {
+        f.angle = max(f.angle - stepAngle, f.targetAngle);
+    }
+    f.angularVelocity = (f.angle - f.prevAngle) * PI / 180.0 / TICK_SCALE;
+}
 
-    // Save last angles
-    leftFlipper.lastAngle = leftFlipper.angle;
-    rightFlipper.lastAngle = rightFlipper.angle;
+void updateFlippers(uint32_t input) {
+    bool facesLeft = !(input & 0x04);
+    bool facesRight = !(input & 0x08);
+    bool facesA = !(input & 0x10);
 
     // Left flipper - starts horizontal (0°), flips UP when activated
-    if (facesLeft || facesA || M5.BtnA.isPressed()) {
+    if (facesLeft || facesA || (input & INPUT_BTN_A)) {
         leftFlipper.targetAngle = 75;   // Flip up position
     } else {
         leftFlipper.targetAngle = 0;    // Down/horizontal resting
     }
 
     // Right flipper - starts horizontal (180°), flips UP when activated
-    if (facesRight || M5.BtnC.isPressed()) {
+    if (facesRight || (input & INPUT_BTN_C)) {
         rightFlipper.targetAngle = 105; // Flip up position
     } else {
         rightFlipper.targetAngle = 180; // Down/horizontal resting
     }
 
-    // Smooth flipper movement
-    if (leftFlipper.angle < leftFlipper.targetAngle) {
-        leftFlipper.angle += FLIPPER_SPEED;
-        if (leftFlipper.angle > leftFlipper.targetAngle)
-            leftFlipper.angle = leftFlipper.targetAngle;
-    } else if (leftFlipper.angle > leftFlipper.targetAngle) {
-        leftFlipper.angle -= FLIPPER_SPEED;
-        if (leftFlipper.angle < leftFlipper.targetAngle)
-            leftFlipper.angle = leftFlipper.targetAngle;
-    }
+    moveFlipper(leftFlipper);
+    moveFlipper(rightFlipper);
+}
 
-    if (rightFlipper.angle < rightFlipper.targetAngle) {
-        rightFlipper.angle += FLIPPER_SPEED;
-        if (rightFlipper.angle > rightFlipper.targetAngle)
-            rightFlipper.angle = rightFlipper.targetAngle;
-    } else if (rightFlipper.angle > rightFlipper.targetAngle) {
-        rightFlipper.angle -= FLIPPER_SPEED;
-        if (rightFlipper.angle < rightFlipper.targetAngle)
-            rightFlipper.angle = rightFlipper.targetAngle;
+static void buildFlipperSteps() {
+    for (int a = 0; a <= 180; a++) {
+        float rad = a * PI / 180.0;
+        FlipperAngleStep &st = flipperSteps[a];
+        st.dx = cos(rad);
+        st.dy = -sin(rad);
+        // d/dt of (cos, -sin) scaled by the distance from the pivot
+        st.tx = st.dy;
+        st.ty = -st.dx;
     }
 }
 
-void checkFlipperCollision(Flipper &f) {
-    if (!ball.active) return;
-
-    int length = 40;
-    float rad = f.angle * PI / 180.0;
-    int x2 = f.x + length * cos(rad);
-    int y2 = f.y - length * sin(rad);
-
-    // Simple distance check to flipper line
-    float dist = abs((y2 - f.y) * ball.x - (x2 - f.x) * ball.y + x2 * f.y - y2 * f.x) /
-                 sqrt((y2 - f.y) * (y2 - f.y) + (x2 - f.x) * (x2 - f.x));
-
-    if (dist < BALL_RADIUS + 3) {
-        // Check if ball is near the flipper segment
-        float dotProduct = (ball.x - f.x) * (x2 - f.x) + (ball.y - f.y) * (y2 - f.y);
-        float lengthSq = (x2 - f.x) * (x2 - f.x) + (y2 - f.y) * (y2 - f.y);
-
-        if (dotProduct >= 0 && dotProduct <= lengthSq) {
-            // Bounce off flipper
-            float nx = -(y2 - f.y);
-            float ny = (x2 - f.x);
-            float len = sqrt(nx * nx + ny * ny);
-            nx /= len;
-            ny /= len;
-
-            float dotVN = ball.vx * nx + ball.vy * ny;
-            ball.vx = ball.vx - 2 * dotVN * nx;
-            ball.vy = ball.vy - 2 * dotVN * ny;
-
-            // Add flipper velocity
-            if (f.angle != f.targetAngle) {
-                ball.vx *= 1.3;
-                ball.vy *= 1.3;
-            }
-        }
+// Resolve ball i against a flipper blade at the given angle. The blade is
+// a capsule around the pivot-to-tip segment; the bounce is taken relative
+// to the blade surface at the contact point, so a swinging flipper hands
+// the ball its tangential speed instead of a fixed boost.
+static void collideFlipper(const Flipper &f, float angle, int i) {
+    const FlipperAngleStep &st = flipperSteps[constrain((int)(angle + 0.5), 0, 180)];
+    float px = balls.x[i] - f.x;
+    float py = balls.y[i] - f.y;
+    float along = constrain(px * st.dx + py * st.dy, 0.0f, (float)FLIPPER_LENGTH);
+    float nx = px - along * st.dx;
+    float ny = py - along * st.dy;
+
+    const float reach = BALL_RADIUS + FLIPPER_RADIUS;
+    float distSq = nx * nx + ny * ny;
+    if (distSq >= reach * reach) return;
+
+    float dist = sqrt(distSq);
+    if (dist > 0) {
+        nx /= dist;
+        ny /= dist;
+    } else {
+        nx = 0;
+        ny = -1;
+    }
+    balls.x[i] += nx * (reach - dist);
+    balls.y[i] += ny * (reach - dist);
+
+    float surfaceVX = f.angularVelocity * along * st.tx;
+    float surfaceVY = f.angularVelocity * along * st.ty;
+    float relN = (balls.vx[i] - surfaceVX) * nx + (balls.vy[i] - surfaceVY) * ny;
+    if (relN < 0) {
+        balls.vx[i] -= (1 + FLIPPER_RESTITUTION) * relN * nx;
+        balls.vy[i] -= (1 + FLIPPER_RESTITUTION) * relN * ny;
     }
 }
 
-void updateBall() {
-    if (!ball.active) return;
+// Extra sub-step speed needed while a swinging blade can reach the ball
+static float flipperSweepSpeed(const Flipper &f, int i) {
+    if (f.angularVelocity == 0) return 0;
+    float reach = sqrt(balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i]) * TICK_SCALE;
+    float range = FLIPPER_LENGTH + BALL_RADIUS + FLIPPER_RADIUS + reach;
+    float dx = balls.x[i] - f.x;
+    float dy = balls.y[i] - f.y;
+    if (dx * dx + dy * dy > range * range) return 0;
+    return fabs(f.angularVelocity) * FLIPPER_LENGTH;
+}
+
+// Sort-and-sweep broadphase on x. The order array is insertion sorted,
+// which is close to linear because balls barely reorder between steps.
+static void checkBallCollisions() {
+    uint8_t *order = balls.order;
+    for (int k = 1; k < balls.count; k++) {
+        uint8_t idx = order[k];
+        float key = balls.x[idx];
+        int j = k - 1;
+        while (j >= 0 && balls.x[order[j]] > key) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = idx;
+    }
 
-    // Save last position
-    ball.lastX = ball.x;
-    ball.lastY = ball.y;
+    const float minDist = 2 * BALL_RADIUS;
+    for (int k = 0; k < balls.count; k++) {
+        int a = order[k];
+        for (int m = k + 1; m < balls.count; m++) {
+            int b = order[m];
+            float dx = balls.x[b] - balls.x[a];
+            if (dx >= minDist) break;  // Nothing further right can touch a
 
-    // Apply gravity
-    ball.vy += GRAVITY;
+            float dy = balls.y[b] - balls.y[a];
+            float distSq = dx * dx + dy * dy;
+            if (distSq >= minDist * minDist || distSq == 0) continue;
 
-    // Update position
-    ball.x += ball.vx;
-    ball.y += ball.vy;
+            float dist = sqrt(distSq);
+            float nx = dx / dist;
+            float ny = dy / dist;
 
-    // Wall collisions
-    if (ball.x - BALL_RADIUS < 5) {
-        ball.x = 5 + BALL_RADIUS;
-        ball.vx = -ball.vx * BOUNCE_DAMPING;
+            // Push apart evenly
+            float overlap = (minDist - dist) * 0.5;
+            balls.x[a] -= nx * overlap;
+            balls.y[a] -= ny * overlap;
+            balls.x[b] += nx * overlap;
+            balls.y[b] += ny * overlap;
+
+            // Equal masses: swap the velocity components along the normal
+            float rel = (balls.vx[b] - balls.vx[a]) * nx + (balls.vy[b] - balls.vy[a]) * ny;
+            if (rel < 0) {
+                balls.vx[a] += rel * nx;
+                balls.vy[a] += rel * ny;
+                balls.vx[b] -= rel * nx;
+                balls.vy[b] -= rel * ny;
+            }
+        }
     }
-    if (ball.x + BALL_RADIUS > 315) {
-        ball.x = 315 - BALL_RADIUS;
-        ball.vx = -ball.vx * BOUNCE_DAMPING;
+}
+
+static void scoreTableHit(const TablePrim &p) {
+    if (p.value > 0 && millis() - lastBumperHit > 100) {
+        score += p.value;
+        lastBumperHit = millis();
     }
-    if (ball.y - BALL_RADIUS < 25) {
-        ball.y = 25 + BALL_RADIUS;
-        ball.vy = -ball.vy * BOUNCE_DAMPING;
+}
+
+// Resolve ball i against the static table geometry
+static void collideStatic(int i) {
+#if TABLE_SDF
+    static_assert(BALL_RADIUS + SDF_CELL * 3 / 2 <= SDF_EXACT_DIST,
+                  "ball contacts fall outside the SDF's exact range");
+    SDFSample sample;
+    if (!sampleTableSDF(*tableSDF, *table, balls.x[i], balls.y[i], sample) ||
+        sample.dist >= BALL_RADIUS) {
+        return;
     }
 
-    // Check bumper collisions
-    for (int i = 0; i < 5; i++) {
-        float dx = ball.x - bumpers[i].x;
-        float dy = ball.y - bumpers[i].y;
-        float dist = sqrt(dx * dx + dy * dy);
+    const TablePrim &p = table->prims[sample.prim];
+    if (bounceOffTablePrim(p, sample.nx, sample.ny, BALL_RADIUS - sample.dist,
+                           balls.x[i], balls.y[i], balls.vx[i], balls.vy[i])) {
+        scoreTableHit(p);
+    }
+#else
+    uint8_t nearby[MAX_TABLE_PRIMS];
+    int hits = queryTable(*table,
+                          balls.x[i] - BALL_RADIUS - 1, balls.y[i] - BALL_RADIUS - 1,
+                          balls.x[i] + BALL_RADIUS + 1, balls.y[i] + BALL_RADIUS + 1,
+                          nearby, MAX_TABLE_PRIMS);
+    for (int h = 0; h < hits; h++) {
+        const TablePrim &p = table->prims[nearby[h]];
+        if (collideTablePrim(p, BALL_RADIUS, balls.x[i], balls.y[i],
+                             balls.vx[i], balls.vy[i])) {
+            scoreTableHit(p);
+        }
+    }
+#endif
+}
 
-        if (dist < BALL_RADIUS + bumpers[i].radius) {
-            // Bounce off bumper
-            float nx = dx / dist;
-            float ny = dy / dist;
+// Boosts stop at TABLE_BOOST_SPEED, so what takes a ball past the cap is
+// a flipper: one falling the height of the table comes off a blade
+// swinging up at about 31 px/tick, and the fuzzer's peak over 100000 runs
+// is 37. Most balls stay under 20. Past that a ball jumps several of its
+// own widths per frame, and every sub-step it costs comes out of the
+// 20 ms tick.
+#if BALL_SPEED_CAP
+static void capBallSpeed(int i) {
+    float speedSq = balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i];
+    if (speedSq > MAX_BALL_SPEED * MAX_BALL_SPEED) {
+        float scale = MAX_BALL_SPEED / sqrt(speedSq);
+        balls.vx[i] *= scale;
+        balls.vy[i] *= scale;
+    }
+}
+#endif
 
-            ball.x = bumpers[i].x + nx * (BALL_RADIUS + bumpers[i].radius);
-            ball.y = bumpers[i].y + ny * (BALL_RADIUS + bumpers[i].radius);
+void updateBalls() {
+    if (balls.count == 0) return;
 
-            float dotVN = ball.vx * nx + ball.vy * ny;
-            ball.vx = ball.vx - 2 * dotVN * nx;
-            ball.vy = ball.vy - 2 * dotVN * ny;
+    int n = balls.count;
 
-            // Add boost
-            ball.vx *= 1.2;
-            ball.vy *= 1.2;
+    // Apply gravity
+    for (int i = 0; i < n; i++) {
+        balls.vy[i] += GRAVITY * TICK_SCALE;
+    }
 
-            // Add score
-            if (millis() - lastBumperHit > 100) {
-                score += bumpers[i].value;
-                lastBumperHit = millis();
-            }
+    // Move in sub-steps short enough that neither static geometry nor a
+    // swinging flipper can be skipped. Flippers sweep from their previous
+    // angle to the current one across the sub-steps.
+    for (int i = 0; i < n; i++) {
+        float speed = sqrt(balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i]) +
+                      max(flipperSweepSpeed(leftFlipper, i),
+                          flipperSweepSpeed(rightFlipper, i));
+        int steps = min(1 + (int)(speed * TICK_SCALE / SUBSTEP_DIST), MAX_SUBSTEPS);
+        for (int s = 0; s < steps; s++) {
+            float t = (s + 1.0) / steps;
+            balls.x[i] += balls.vx[i] * TICK_SCALE / steps;
+            balls.y[i] += balls.vy[i] * TICK_SCALE / steps;
+            collideStatic(i);
+            collideFlipper(leftFlipper,
+                           leftFlipper.prevAngle + (leftFlipper.angle - leftFlipper.prevAngle) * t, i);
+            collideFlipper(rightFlipper,
+                           rightFlipper.prevAngle + (rightFlipper.angle - rightFlipper.prevAngle) * t, i);
         }
     }
 
-    // Check flipper collisions
-    checkFlipperCollision(leftFlipper);
-    checkFlipperCollision(rightFlipper);
+    // Pushing touching balls apart can shove one into the table, and from
+    // there the next tick would carry it on through. Put it back out.
+    checkBallCollisions();
+    for (int i = 0; i < n; i++) {
+        collideStatic(i);
+    }
 
-    // Check if ball is lost (drain)
-    if (ball.y > 235) {
+#if BALL_SPEED_CAP
+    for (int i = 0; i < n; i++) {
+        capBallSpeed(i);
+    }
+#endif
+
+    // Check if any ball is lost (drain)
+    for (int i = balls.count - 1; i >= 0; i--) {
+        if (balls.y[i] > 235) {
+            removeBall(i);
+        }
+    }
+
+    // Only the last drained ball costs a life
+    if (balls.count == 0) {
+        ballInPlay = false;
         lives--;
-        if (lives > 0) {
-            resetBall();
-        } else {
+        if (lives <= 0) {
             gameOver = true;
-            ball.active = false;
         }
+        return;
+    }
+
+    // Multiball award
+    if (score >= nextMultiballScore) {
+        nextMultiballScore += MULTIBALL_SCORE;
+        startMultiball();
     }
 }
 
+static void publishSnapshot() {
+    PinballSnapshot &snap = snapshots->back();
+    for (int i = 0; i < balls.count; i++) {
+        snap.ballX[i] = balls.x[i];
+        snap.ballY[i] = balls.y[i];
+        snap.ballColor[i] = balls.color[i];
+    }
+    snap.ballCount = balls.count;
+    snap.leftAngle = leftFlipper.angle;
+    snap.rightAngle = rightFlipper.angle;
+    snap.score = score;
+    snap.lives = lives;
+    snap.ballInPlay = ballInPlay;
+    snap.gameOver = gameOver;
+    snapshots->publish();
+}
+
+// One fixed physics step. Runs on the update task when PHYSICS_TASK is
+// set, otherwise once per frame from game2Loop().
+static void stepPinball() {
+    if (restartRequested.exchange(false)) {
+        setupPinball();
+    }
+    if (launchRequested.exchange(false) && !ballInPlay && lives > 0 && !gameOver) {
+        launchBall();
+    }
+
+    if (!gameOver) {
+        updateFlippers(pinballInput.load());
+        updateBalls();
+    }
+    publishSnapshot();
+}
+
 void game2Setup() {
     M5.Lcd.fillScreen(TFT_BLACK);
     M5.Lcd.setTextColor(TFT_YELLOW);
@@ -331,26 +605,89 @@ void game2Setup() {
     M5.Lcd.setCursor(40, 160);
     M5.Lcd.println("B: Launch Ball");
 
-    delay(2500);
+    // The SDF is the slow part; it is built a few rows per pass while the
+    // title is up
+    flipperSteps = arenaArray<FlipperAngleStep>(181);
+    table = arenaArray<PinballTable>(1);
+    tableSDF = arenaArray<TableSDF>(1);
+    snapshots = arenaNew<TripleBuffer<PinballSnapshot>>();
+
+    loadTable(*table);
+    buildFlipperSteps();
 
+    // After the table, so the font isn't resident under the file scratch
+    hudFont = arenaArray<FontCache>(1);
+    cacheFont(*hudFont, "Score:Lives0123456789 ", 2);
+    redrawStrip = arenaArray<uint16_t>(SCREEN_WIDTH * REDRAW_ROWS);
+    warmRow = 0;
+
+    readFacesButtons();
+    startTitle(title, TITLE_MS, ~facesData);
+    inTitle = true;
+}
+
+// One slice of the SDF build, true once every row is done
+static bool warmUpTable() {
+    uint32_t sliceStart = millis();
+    while (warmRow < SDF_ROWS && titleSliceLeft(sliceStart)) {
+        buildTableSDFRows(*tableSDF, *table, warmRow, 1);
+        warmRow++;
+    }
+    return warmRow == SDF_ROWS;
+}
+
+static void startPinball() {
     setupPinball();
+    publishSnapshot();
+    snapshots->update();
+    drawn = snapshots->front();
+    needsFullRedraw = true;
+
+#if PHYSICS_TASK
+    startUpdateTask(stepPinball, PHYSICS_PERIOD_MS);
+#endif
+}
+
+void game2Teardown() {
+    stopUpdateTask();
 }
 
 void game2Loop() {
+    if (inTitle) {
+        bool warmed = warmUpTable();
+        readFacesButtons();
+        if (!updateTitle(title, ~facesData, warmed)) return;
+        inTitle = false;
+        startPinball();
+    }
+
     M5.update();
     readFacesButtons();
 
+    uint32_t input = facesData;
+    if (M5.BtnA.isPressed()) input |= INPUT_BTN_A;
+    if (M5.BtnC.isPressed()) input |= INPUT_BTN_C;
+    pinballInput.store(input);
+
     bool facesB = !(facesData & 0x20);
     static bool lastB = false;
+    bool bPressed = facesB && !lastB;
+    lastB = facesB;
+
+#if !PHYSICS_TASK
+    stepPinball();
+#endif
+
+    snapshots->update();
+    const PinballSnapshot &snap = snapshots->front();
 
     // Launch ball with B button
-    if (facesB && !lastB && !ballInPlay && lives > 0 && !gameOver) {
-        launchBall();
+    if (bPressed && !snap.ballInPlay && snap.lives > 0 && !snap.gameOver) {
+        launchRequested.store(true);
     }
-    lastB = facesB;
 
     // Restart game on game over
-    if (gameOver) {
+    if (snap.gameOver) {
         M5.Lcd.fillScreen(TFT_BLACK);
         M5.Lcd.setTextSize(3);
         M5.Lcd.setTextColor(TFT_RED);
@@ -360,68 +697,52 @@ void game2Loop() {
         M5.Lcd.setTextColor(TFT_YELLOW);
         M5.Lcd.setCursor(60, 120);
         M5.Lcd.print("Score: ");
-        M5.Lcd.println(score);
+        M5.Lcd.println(snap.score);
         M5.Lcd.setTextSize(1);
         M5.Lcd.setTextColor(TFT_WHITE);
         M5.Lcd.setCursor(50, 160);
         M5.Lcd.println("B: Again  Select: Menu");
+        if (capturing()) captureRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-        if (facesB && !lastB) {
-            setupPinball();
+        if (bPressed) {
+            restartRequested.store(true);
+            needsFullRedraw = true;
         }
         delay(50);
         return;
     }
 
+    beginLcdFrame();
+
     // Full redraw if needed
     if (needsFullRedraw) {
-        M5.Lcd.fillRect(0, 20, 320, 220, TFT_DARKGREEN);
-        M5.Lcd.drawRect(0, 20, 320, 220, TFT_WHITE);
-        M5.Lcd.drawRect(1, 21, 318, 218, TFT_WHITE);
-
-        // Draw bumpers
-        for (int i = 0; i < 5; i++) {
-            drawBumper(bumpers[i]);
-        }
+        redrawPlayfield();
+        drawn.ballCount = 0;
         needsFullRedraw = false;
     }
 
-    // Draw score and lives (always update)
-    M5.Lcd.fillRect(0, 0, 320, 20, TFT_BLACK);
-    M5.Lcd.setTextSize(2);
-    M5.Lcd.setTextColor(TFT_YELLOW, TFT_BLACK);
-    M5.Lcd.setCursor(5, 2);
-    M5.Lcd.print("Score:");
-    M5.Lcd.print(score);
-    M5.Lcd.setCursor(220, 2);
-    M5.Lcd.print("Lives:");
-    M5.Lcd.print(lives);
-
-    // Update game objects
-    updateFlippers();
-    updateBall();
-
-    // Erase old positions
-    eraseBall();
-    eraseFlipper(leftFlipper);
-    eraseFlipper(rightFlipper);
-
-    // Redraw bumpers if ball/flipper was near them
-    for (int i = 0; i < 5; i++) {
-        float dx = ball.lastX - bumpers[i].x;
-        float dy = ball.lastY - bumpers[i].y;
-        if (sqrt(dx*dx + dy*dy) < 20) {
-            drawBumper(bumpers[i]);
-        }
-    }
+    // Draw score and lives (always update). Opaque and padded, so the
+    // strip needs no clearing first.
+    char text[16];
+    snprintf(text, sizeof(text), "Score:%-6d", snap.score);
+    drawCachedText(*hudFont, 5, 2, text, TFT_YELLOW, TFT_BLACK);
+    snprintf(text, sizeof(text), "Lives:%d", snap.lives);
+    drawCachedText(*hudFont, 220, 2, text, TFT_YELLOW, TFT_BLACK);
+
+    // Erase what the previous frame drew
+    eraseBalls(drawn);
+    eraseFlipper(table->leftFlipperX, table->leftFlipperY, drawn.leftAngle);
+    eraseFlipper(table->rightFlipperX, table->rightFlipperY, drawn.rightAngle);
 
     // Draw current positions
-    drawFlipper(leftFlipper);
-    drawFlipper(rightFlipper);
-    drawBall();
+    drawFlipper(table->leftFlipperX, table->leftFlipperY, snap.leftAngle, FLIPPER_COLOR);
+    drawFlipper(table->rightFlipperX, table->rightFlipperY, snap.rightAngle, FLIPPER_COLOR);
+    drawBalls(snap);
+    drawn = snap;
 
     // Launch indicator
-    if (!ballInPlay && lives > 0) {
+    if (!snap.ballInPlay && snap.lives > 0) {
+        lcdBatchBreak();
         M5.Lcd.fillRect(230, 185, 90, 30, TFT_DARKGREEN);
         M5.Lcd.setTextSize(1);
         M5.Lcd.setTextColor(TFT_WHITE);
@@ -429,7 +750,9 @@ void game2Loop() {
         M5.Lcd.println("Press B");
         M5.Lcd.setCursor(235, 200);
         M5.Lcd.println("to Launch!");
+        if (capturing()) captureRect(230, 185, 90, 30);
     }
+    endLcdFrame();
 
-    delay(20);
+    delay(GAME2_FRAME_MS);
 }
@@ -3,7 +3,10 @@
 
 #include <M5Stack.h>
 
+#define GAME2_FRAME_MS 20     // What the loop paces itself to
+
 void game2Setup();
 void game2Loop();
+void game2Teardown();
 
 #endif
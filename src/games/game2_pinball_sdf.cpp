@@ -0,0 +1,111 @@
+#include "game2_pinball_sdf.h"
+
+// Largest distance the fixed point grid stores, anything further is "far"
+#define SDF_MAX_DIST (INT16_MAX / SDF_ONE)
+
+void buildTableSDF(TableSDF &sdf, const PinballTable &table) {
+    buildTableSDFRows(sdf, table, 0, SDF_ROWS);
+}
+
+void buildTableSDFRows(TableSDF &sdf, const PinballTable &table, int firstRow, int count) {
+    int endRow = min(firstRow + count, SDF_ROWS);
+    for (int row = firstRow; row < endRow; row++) {
+        for (int col = 0; col < SDF_COLS; col++) {
+            float x = col * SDF_CELL;
+            float y = row * SDF_CELL;
+
+            float best = SDF_MAX_DIST;
+            float bestNx = 0, bestNy = -1;
+            uint8_t bestPrim = 0;
+            for (int i = 0; i < table.primCount; i++) {
+                float nx, ny;
+                float d = tablePrimDistance(table.prims[i], x, y, nx, ny);
+                if (d < best) {
+                    best = d;
+                    bestNx = nx;
+                    bestNy = ny;
+                    bestPrim = i;
+                }
+            }
+
+            sdf.dist[row][col] = (int16_t)(best * SDF_ONE);
+            sdf.nx[row][col] = (int8_t)(bestNx * SDF_NORMAL_ONE);
+            sdf.ny[row][col] = (int8_t)(bestNy * SDF_NORMAL_ONE);
+            sdf.prim[row][col] = bestPrim;
+        }
+    }
+}
+
+// Nearest of the primitives nearest the cell's corners, measured at the
+// point itself
+static void measureNearCorners(const TableSDF &sdf, const PinballTable &table, int col,
+                               int row, float x, float y, SDFSample &out) {
+    uint8_t corners[4] = {sdf.prim[row][col], sdf.prim[row][col + 1],
+                          sdf.prim[row + 1][col], sdf.prim[row + 1][col + 1]};
+    out.dist = TABLE_FAR;
+    out.nx = 0;
+    out.ny = -1;
+    out.prim = corners[0];
+    for (int i = 0; i < 4; i++) {
+        bool seen = false;
+        for (int j = 0; j < i; j++) seen |= corners[j] == corners[i];
+        if (seen || corners[i] >= table.primCount) continue;
+
+        float nx, ny;
+        float d = tablePrimDistance(table.prims[corners[i]], x, y, nx, ny);
+        if (d < out.dist) {
+            out.dist = d;
+            out.nx = nx;
+            out.ny = ny;
+            out.prim = corners[i];
+        }
+    }
+}
+
+bool sampleTableSDF(const TableSDF &sdf, const PinballTable &table, float x, float y,
+                    SDFSample &out) {
+    if (x < 0 || y < 0) return false;
+
+    // Cell and 8-bit fractional position inside it
+    int fx = (int)(x * (256 / SDF_CELL));
+    int fy = (int)(y * (256 / SDF_CELL));
+    int col = fx >> 8;
+    int row = fy >> 8;
+    if (col >= SDF_COLS - 1 || row >= SDF_ROWS - 1) return false;
+    int tx = fx & 0xFF;
+    int ty = fy & 0xFF;
+
+    // Corner weights, summing to 65536
+    int w00 = (256 - tx) * (256 - ty);
+    int w10 = tx * (256 - ty);
+    int w01 = (256 - tx) * ty;
+    int w11 = tx * ty;
+
+    int32_t d = w00 * sdf.dist[row][col] + w10 * sdf.dist[row][col + 1] +
+                w01 * sdf.dist[row + 1][col] + w11 * sdf.dist[row + 1][col + 1];
+    out.dist = d / (65536.0 * SDF_ONE);
+    if (out.dist < SDF_EXACT_DIST) {
+        measureNearCorners(sdf, table, col, row, x, y, out);
+        return true;
+    }
+
+    int32_t nx = w00 * sdf.nx[row][col] + w10 * sdf.nx[row][col + 1] +
+                 w01 * sdf.nx[row + 1][col] + w11 * sdf.nx[row + 1][col + 1];
+    int32_t ny = w00 * sdf.ny[row][col] + w10 * sdf.ny[row][col + 1] +
+                 w01 * sdf.ny[row + 1][col] + w11 * sdf.ny[row + 1][col + 1];
+
+    float len = sqrt((float)nx * nx + (float)ny * ny);
+    if (len == 0) {
+        out.nx = 0;
+        out.ny = -1;
+    } else {
+        out.nx = nx / len;
+        out.ny = ny / len;
+    }
+
+    // Response properties come from the primitive nearest the ball
+    int nearCol = col + (tx >> 7);
+    int nearRow = row + (ty >> 7);
+    out.prim = sdf.prim[nearRow][nearCol];
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef GAME2_PINBALL_SDF_H
+#define GAME2_PINBALL_SDF_H
+
+#include "game2_pinball_table.h"
+
+// Coarse signed distance field over the static table geometry. Built once
+// when a table loads, so a ball's static collision test is a bilinear
+// lookup instead of a walk over every primitive. Blending the corners is
+// only good away from the surface: near a thin segment or an arc the
+// corners' normals point opposite ways and cancel. Close in, the sample
+// is measured exactly against the primitives nearest the cell's corners,
+// so the distance, normal and primitive all agree.
+
+#define SDF_CELL 4             // Grid spacing in pixels
+#define SDF_COLS (320 / SDF_CELL + 1)
+#define SDF_ROWS (240 / SDF_CELL + 1)
+#define SDF_ONE 16             // Fixed point distance units per pixel
+#define SDF_NORMAL_ONE 127     // Fixed point units of a unit normal
+
+// Blended distances are off by at most a cell diagonal, so below this a
+// sample is measured exactly. Anything colliding at a radius r needs
+// r + 1.5 * SDF_CELL to be within it.
+#define SDF_EXACT_DIST 10
+
+struct TableSDF {
+    int16_t dist[SDF_ROWS][SDF_COLS];   // Signed distance, negative inside
+    int8_t nx[SDF_ROWS][SDF_COLS];      // Outward normal of the nearest surface
+    int8_t ny[SDF_ROWS][SDF_COLS];
+    uint8_t prim[SDF_ROWS][SDF_COLS];   // Index of the nearest primitive
+};
+
+struct SDFSample {
+    float dist;
+    float nx, ny;
+    uint8_t prim;
+};
+
+void buildTableSDF(TableSDF &sdf, const PinballTable &table);
+
+// Fill only rows [firstRow, firstRow + count), so the build can be spread
+// over several frames
+void buildTableSDFRows(TableSDF &sdf, const PinballTable &table, int firstRow, int count);
+
+// Returns false outside the grid
+bool sampleTableSDF(const TableSDF &sdf, const PinballTable &table, float x, float y,
+                    SDFSample &out);
+
+#endif
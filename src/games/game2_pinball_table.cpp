@@ -0,0 +1,531 @@
+#include "game2_pinball_table.h"
+#include "../engine/arena.h"
+
+#define WALL_DEPTH 24          // How far behind a wall still counts as inside it
+#define BVH_LEAF_SIZE 2
+#define MAX_LINE_LENGTH 96
+#define MAX_TABLE_FILE 4096
+
+// Built-in table, used when no table file is on the SD card
+static const char DEFAULT_TABLE[] =
+    "# Outer walls\n"
+    "wall 5 240 5 25\n"
+    "wall 5 25 315 25\n"
+    "wall 315 25 315 240\n"
+    "# Bumpers\n"
+    "bumper 80 60 12 RED 100\n"
+    "bumper 160 50 12 ORANGE 100\n"
+    "bumper 240 60 12 RED 100\n"
+    "bumper 120 100 12 CYAN 50\n"
+    "bumper 200 100 12 CYAN 50\n"
+    "# Flippers\n"
+    "flipper left 80 220\n"
+    "flipper right 240 220\n";
+
+struct ColorName {
+    const char *name;
+    uint16_t color;
+};
+
+static const ColorName COLOR_NAMES[] = {
+    {"BLACK", TFT_BLACK},
+    {"WHITE", TFT_WHITE},
+    {"RED", TFT_RED},
+    {"GREEN", TFT_GREEN},
+    {"BLUE", TFT_BLUE},
+    {"CYAN", TFT_CYAN},
+    {"YELLOW", TFT_YELLOW},
+    {"ORANGE", TFT_ORANGE},
+    {"MAGENTA", TFT_MAGENTA},
+    {"PURPLE", TFT_PURPLE},
+    {"PINK", TFT_PINK},
+    {"GREENYELLOW", TFT_GREENYELLOW},
+    {"LIGHTGREY", TFT_LIGHTGREY}
+};
+
+static uint16_t parseColor(const char *token) {
+    for (unsigned i = 0; i < sizeof(COLOR_NAMES) / sizeof(COLOR_NAMES[0]); i++) {
+        if (strcasecmp(token, COLOR_NAMES[i].name) == 0) {
+            return COLOR_NAMES[i].color;
+        }
+    }
+    return (uint16_t)strtol(token, NULL, 0);
+}
+
+static void computeBounds(TablePrim &p) {
+    switch (p.type) {
+        case PRIM_WALL:
+            p.minX = min(p.x1, p.x2) - WALL_DEPTH;
+            p.minY = min(p.y1, p.y2) - WALL_DEPTH;
+            p.maxX = max(p.x1, p.x2) + WALL_DEPTH;
+            p.maxY = max(p.y1, p.y2) + WALL_DEPTH;
+            break;
+        case PRIM_SEGMENT:
+            p.minX = min(p.x1, p.x2);
+            p.minY = min(p.y1, p.y2);
+            p.maxX = max(p.x1, p.x2);
+            p.maxY = max(p.y1, p.y2);
+            break;
+        case PRIM_ARC:
+        case PRIM_BUMPER:
+            // Bumpers include their outline ring
+            p.minX = p.x1 - p.radius - 1;
+            p.minY = p.y1 - p.radius - 1;
+            p.maxX = p.x1 + p.radius + 1;
+            p.maxY = p.y1 + p.radius + 1;
+            break;
+    }
+}
+
+// Parse one line into the table. Unknown or short lines are skipped.
+static void parseLine(PinballTable &table, char *line) {
+    char *tokens[10];
+    int count = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(line, " \t\r", &save); tok && count < 10;
+         tok = strtok_r(NULL, " \t\r", &save)) {
+        if (tok[0] == '#') break;
+        tokens[count++] = tok;
+    }
+    if (count == 0) return;
+
+    if (strcmp(tokens[0], "flipper") == 0 && count >= 4) {
+        if (strcmp(tokens[1], "left") == 0) {
+            table.leftFlipperX = atoi(tokens[2]);
+            table.leftFlipperY = atoi(tokens[3]);
+        } else {
+            table.rightFlipperX = atoi(tokens[2]);
+            table.rightFlipperY = atoi(tokens[3]);
+        }
+        return;
+    }
+
+    if (table.primCount >= MAX_TABLE_PRIMS) return;
+    TablePrim &p = table.prims[table.primCount];
+    memset(&p, 0, sizeof(p));
+    p.restitution = 1.0;
+    p.boost = 1.0;
+
+    if (strcmp(tokens[0], "wall") == 0 && count >= 5) {
+        p.type = PRIM_WALL;
+        p.restitution = 0.85;
+        p.color = count >= 6 ? parseColor(tokens[5]) : TFT_WHITE;
+    } else if (strcmp(tokens[0], "seg") == 0 && count >= 6) {
+        p.type = PRIM_SEGMENT;
+        p.restitution = 0.85;
+        p.color = parseColor(tokens[5]);
+        if (count >= 7) p.boost = atof(tokens[6]);
+        if (count >= 8) p.value = atoi(tokens[7]);
+    } else if (strcmp(tokens[0], "arc") == 0 && count >= 7) {
+        p.type = PRIM_ARC;
+        p.restitution = 0.85;
+        p.x1 = atoi(tokens[1]);
+        p.y1 = atoi(tokens[2]);
+        p.radius = atoi(tokens[3]);
+        p.a0 = atoi(tokens[4]);
+        p.a1 = atoi(tokens[5]);
+        if (p.a1 < p.a0) p.a1 += 360;
+        p.color = parseColor(tokens[6]);
+        computeBounds(p);
+        table.primCount++;
+        return;
+    } else if (strcmp(tokens[0], "bumper") == 0 && count >= 6) {
+        p.type = PRIM_BUMPER;
+        p.boost = 1.2;
+        p.x1 = atoi(tokens[1]);
+        p.y1 = atoi(tokens[2]);
+        p.radius = atoi(tokens[3]);
+        p.color = parseColor(tokens[4]);
+        p.value = atoi(tokens[5]);
+        computeBounds(p);
+        table.primCount++;
+        return;
+    } else {
+        return;
+    }
+
+    // Walls and segments share their endpoint layout
+    p.x1 = atoi(tokens[1]);
+    p.y1 = atoi(tokens[2]);
+    p.x2 = atoi(tokens[3]);
+    p.y2 = atoi(tokens[4]);
+    if (p.x1 == p.x2 && p.y1 == p.y2) {
+        // No direction to take a normal from
+        Serial.printf("Table: zero-length %s at %d,%d skipped\n", tokens[0], p.x1, p.y1);
+        return;
+    }
+    computeBounds(p);
+    table.primCount++;
+}
+
+bool parseTable(PinballTable &table, const char *text) {
+    table.primCount = 0;
+    table.nodeCount = 0;
+    table.leftFlipperX = 80;
+    table.leftFlipperY = 220;
+    table.rightFlipperX = 240;
+    table.rightFlipperY = 220;
+
+    char line[MAX_LINE_LENGTH];
+    while (*text) {
+        int len = 0;
+        while (*text && *text != '\n') {
+            if (len < MAX_LINE_LENGTH - 1) line[len++] = *text;
+            text++;
+        }
+        if (*text == '\n') text++;
+        line[len] = '\0';
+        parseLine(table, line);
+    }
+
+    buildTableBVH(table);
+    return table.primCount > 0;
+}
+
+void loadTable(PinballTable &table) {
+    File f = SD.open(TABLE_PATH);
+    if (f && f.size() >= MAX_TABLE_FILE) {
+        Serial.printf("Table: %s is %u bytes, more than %d\n", TABLE_PATH,
+                      (unsigned)f.size(), MAX_TABLE_FILE - 1);
+        f.close();
+    } else if (f) {
+        // The file text is only needed while parsing
+        size_t mark = arenaMark();
+        char *text = arenaArray<char>(MAX_TABLE_FILE);
+        size_t len = f.read((uint8_t *)text, MAX_TABLE_FILE - 1);
+        text[len] = '\0';
+        f.close();
+        bool parsed = parseTable(table, text);
+        arenaRelease(mark);
+        if (parsed) {
+            return;
+        }
+    }
+    parseTable(table, DEFAULT_TABLE);
+}
+
+static int centreX(const TablePrim &p) { return p.minX + p.maxX; }
+static int centreY(const TablePrim &p) { return p.minY + p.maxY; }
+
+// Build nodes depth first so the left child always follows its parent
+static int buildNode(PinballTable &table, int first, int count) {
+    int index = table.nodeCount++;
+    TableNode &node = table.nodes[index];
+
+    node.minX = node.minY = INT16_MAX;
+    node.maxX = node.maxY = INT16_MIN;
+    int cMinX = INT16_MAX, cMinY = INT16_MAX, cMaxX = INT16_MIN, cMaxY = INT16_MIN;
+    for (int i = first; i < first + count; i++) {
+        const TablePrim &p = table.prims[table.primOrder[i]];
+        node.minX = min(node.minX, p.minX);
+        node.minY = min(node.minY, p.minY);
+        node.maxX = max(node.maxX, p.maxX);
+        node.maxY = max(node.maxY, p.maxY);
+        cMinX = min(cMinX, centreX(p));
+        cMinY = min(cMinY, centreY(p));
+        cMaxX = max(cMaxX, centreX(p));
+        cMaxY = max(cMaxY, centreY(p));
+    }
+
+    if (count <= BVH_LEAF_SIZE) {
+        node.first = first;
+        node.count = count;
+        node.right = 0;
+        return index;
+    }
+
+    // Median split along the longer axis of the centre spread
+    bool splitX = (cMaxX - cMinX) >= (cMaxY - cMinY);
+    uint8_t *order = table.primOrder;
+    for (int i = first + 1; i < first + count; i++) {
+        uint8_t idx = order[i];
+        const TablePrim &p = table.prims[idx];
+        int key = splitX ? centreX(p) : centreY(p);
+        int j = i - 1;
+        while (j >= first) {
+            const TablePrim &q = table.prims[order[j]];
+            if ((splitX ? centreX(q) : centreY(q)) <= key) break;
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = idx;
+    }
+
+    int half = count / 2;
+    node.first = 0;
+    node.count = 0;
+    buildNode(table, first, half);
+    int right = buildNode(table, first + half, count - half);
+    table.nodes[index].right = right;
+    return index;
+}
+
+void buildTableBVH(PinballTable &table) {
+    table.nodeCount = 0;
+    if (table.primCount == 0) return;
+
+    for (int i = 0; i < table.primCount; i++) {
+        table.primOrder[i] = i;
+    }
+    buildNode(table, 0, table.primCount);
+}
+
+int queryTable(const PinballTable &table, int16_t minX, int16_t minY,
+               int16_t maxX, int16_t maxY, uint8_t *out, int maxOut) {
+    if (table.nodeCount == 0) return 0;
+
+    uint8_t stack[32];
+    int top = 0;
+    int found = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const TableNode &node = table.nodes[stack[--top]];
+        if (node.maxX < minX || node.minX > maxX ||
+            node.maxY < minY || node.minY > maxY) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                const TablePrim &p = table.prims[table.primOrder[i]];
+                if (p.maxX < minX || p.minX > maxX ||
+                    p.maxY < minY || p.minY > maxY) {
+                    continue;
+                }
+                if (found < maxOut) out[found++] = table.primOrder[i];
+            }
+        } else {
+            int index = &node - table.nodes;
+            stack[top++] = node.right;
+            stack[top++] = index + 1;
+        }
+    }
+    return found;
+}
+
+bool bounceOffTablePrim(const TablePrim &p, float nx, float ny, float depth,
+                        float &x, float &y, float &vx, float &vy) {
+    x += nx * depth;
+    y += ny * depth;
+
+    float dotVN = vx * nx + vy * ny;
+    if (dotVN >= 0) return false;
+
+    vx -= (1 + p.restitution) * dotVN * nx;
+    vy -= (1 + p.restitution) * dotVN * ny;
+
+    // A boost kicks a slow ball up to TABLE_BOOST_SPEED, not past it, so a
+    // ball rattling between bumpers can't gain speed without end
+    if (p.boost > 1) {
+        float speed = sqrt(vx * vx + vy * vy);
+        float boosted = max(speed, min(speed * p.boost, (float)TABLE_BOOST_SPEED));
+        if (speed > 0) {
+            vx *= boosted / speed;
+            vy *= boosted / speed;
+        }
+    }
+    return true;
+}
+
+// Contact against a single point (segment and arc end caps)
+static bool collidePoint(const TablePrim &p, float px, float py, float radius,
+                         float &x, float &y, float &vx, float &vy) {
+    float dx = x - px;
+    float dy = y - py;
+    float distSq = dx * dx + dy * dy;
+    if (distSq >= radius * radius || distSq == 0) return false;
+
+    float dist = sqrt(distSq);
+    return bounceOffTablePrim(p, dx / dist, dy / dist, radius - dist, x, y, vx, vy);
+}
+
+bool collideTablePrim(const TablePrim &p, float radius,
+                      float &x, float &y, float &vx, float &vy) {
+    switch (p.type) {
+        case PRIM_WALL: {
+            float ex = p.x2 - p.x1;
+            float ey = p.y2 - p.y1;
+            float len = sqrt(ex * ex + ey * ey);
+            float nx = -ey / len;
+            float ny = ex / len;
+            float rx = x - p.x1;
+            float ry = y - p.y1;
+            float along = (rx * ex + ry * ey) / len;
+            if (along < 0 || along > len) return false;
+
+            float d = rx * nx + ry * ny;
+            if (d >= radius || d <= -WALL_DEPTH) return false;
+            return bounceOffTablePrim(p, nx, ny, radius - d, x, y, vx, vy);
+        }
+
+        case PRIM_SEGMENT: {
+            float ex = p.x2 - p.x1;
+            float ey = p.y2 - p.y1;
+            float lengthSq = ex * ex + ey * ey;
+            float t = ((x - p.x1) * ex + (y - p.y1) * ey) / lengthSq;
+            if (t < 0) t = 0;
+            if (t > 1) t = 1;
+            return collidePoint(p, p.x1 + t * ex, p.y1 + t * ey, radius, x, y, vx, vy);
+        }
+
+        case PRIM_ARC: {
+            float dx = x - p.x1;
+            float dy = y - p.y1;
+            float dist = sqrt(dx * dx + dy * dy);
+            if (dist == 0) return false;
+
+            float angle = atan2(-dy, dx) * 180.0 / PI;
+            if (angle < p.a0) angle += 360;
+            if (angle <= p.a1) {
+                float d = dist - p.radius;
+                if (fabs(d) >= radius) return false;
+                float s = (d >= 0) ? 1 : -1;
+                return bounceOffTablePrim(p, s * dx / dist, s * dy / dist, radius - fabs(d), x, y, vx, vy);
+            }
+
+            // Outside the sweep, only the end caps can touch
+            float r0 = p.a0 * PI / 180.0;
+            float r1 = p.a1 * PI / 180.0;
+            if (collidePoint(p, p.x1 + p.radius * cos(r0), p.y1 - p.radius * sin(r0),
+                             radius, x, y, vx, vy)) {
+                return true;
+            }
+            return collidePoint(p, p.x1 + p.radius * cos(r1), p.y1 - p.radius * sin(r1),
+                                radius, x, y, vx, vy);
+        }
+
+        case PRIM_BUMPER: {
+            float dx = x - p.x1;
+            float dy = y - p.y1;
+            float reach = radius + p.radius;
+            float distSq = dx * dx + dy * dy;
+            if (distSq >= reach * reach || distSq == 0) return false;
+
+            float dist = sqrt(distSq);
+            return bounceOffTablePrim(p, dx / dist, dy / dist, reach - dist, x, y, vx, vy);
+        }
+    }
+    return false;
+}
+
+// Distance and outward normal from a single point
+static float pointDistance(float px, float py, float x, float y,
+                           float &nx, float &ny) {
+    float dx = x - px;
+    float dy = y - py;
+    float dist = sqrt(dx * dx + dy * dy);
+    if (dist == 0) {
+        nx = 0;
+        ny = -1;
+        return 0;
+    }
+    nx = dx / dist;
+    ny = dy / dist;
+    return dist;
+}
+
+float tablePrimDistance(const TablePrim &p, float x, float y, float &nx, float &ny) {
+    switch (p.type) {
+        case PRIM_WALL: {
+            float ex = p.x2 - p.x1;
+            float ey = p.y2 - p.y1;
+            float len = sqrt(ex * ex + ey * ey);
+            float rx = x - p.x1;
+            float ry = y - p.y1;
+            float along = (rx * ex + ry * ey) / len;
+            if (along < 0) return pointDistance(p.x1, p.y1, x, y, nx, ny);
+            if (along > len) return pointDistance(p.x2, p.y2, x, y, nx, ny);
+
+            nx = -ey / len;
+            ny = ex / len;
+            float d = rx * nx + ry * ny;
+            return (d <= -WALL_DEPTH) ? TABLE_FAR : d;
+        }
+
+        case PRIM_SEGMENT: {
+            float ex = p.x2 - p.x1;
+            float ey = p.y2 - p.y1;
+            float t = ((x - p.x1) * ex + (y - p.y1) * ey) / (ex * ex + ey * ey);
+            if (t < 0) t = 0;
+            if (t > 1) t = 1;
+            return pointDistance(p.x1 + t * ex, p.y1 + t * ey, x, y, nx, ny);
+        }
+
+        case PRIM_ARC: {
+            float dx = x - p.x1;
+            float dy = y - p.y1;
+            float angle = atan2(-dy, dx) * 180.0 / PI;
+            if (angle < p.a0) angle += 360;
+            if (angle <= p.a1) {
+                float dist = pointDistance(p.x1, p.y1, x, y, nx, ny);
+                float d = dist - p.radius;
+                if (d < 0) {
+                    nx = -nx;
+                    ny = -ny;
+                }
+                return fabs(d);
+            }
+
+            float r0 = p.a0 * PI / 180.0;
+            float r1 = p.a1 * PI / 180.0;
+            float nx1, ny1;
+            float d0 = pointDistance(p.x1 + p.radius * cos(r0), p.y1 - p.radius * sin(r0), x, y, nx, ny);
+            float d1 = pointDistance(p.x1 + p.radius * cos(r1), p.y1 - p.radius * sin(r1), x, y, nx1, ny1);
+            if (d1 < d0) {
+                nx = nx1;
+                ny = ny1;
+                return d1;
+            }
+            return d0;
+        }
+
+        case PRIM_BUMPER:
+            return pointDistance(p.x1, p.y1, x, y, nx, ny) - p.radius;
+    }
+    return TABLE_FAR;
+}
+
+// Arcs are drawn as chords every 5 degrees
+static void arcPoint(const TablePrim &p, int a, int &x, int &y) {
+    float rad = min(a, (int)p.a1) * PI / 180.0;
+    x = p.x1 + p.radius * cos(rad);
+    y = p.y1 - p.radius * sin(rad);
+}
+
+void drawTablePrimTile(const TablePrim &p, RasterTile &tile) {
+    switch (p.type) {
+        case PRIM_WALL: {
+            // The surface, and a line one pixel behind it on the solid side
+            float ex = p.x2 - p.x1;
+            float ey = p.y2 - p.y1;
+            float len = sqrt(ex * ex + ey * ey);
+            int bx = (int)roundf(ey / len);
+            int by = (int)roundf(-ex / len);
+            tileLine(tile, p.x1, p.y1, p.x2, p.y2, p.color);
+            tileLine(tile, p.x1 + bx, p.y1 + by, p.x2 + bx, p.y2 + by, p.color);
+            break;
+        }
+
+        case PRIM_SEGMENT:
+            tileLine(tile, p.x1, p.y1, p.x2, p.y2, p.color);
+            break;
+
+        case PRIM_ARC: {
+            int lastX, lastY;
+            arcPoint(p, p.a0, lastX, lastY);
+            for (int a = p.a0 + 5; a <= p.a1 + 4; a += 5) {
+                int x, y;
+                arcPoint(p, a, x, y);
+                tileLine(tile, lastX, lastY, x, y, p.color);
+                lastX = x;
+                lastY = y;
+            }
+            break;
+        }
+
+        case PRIM_BUMPER:
+            tileCircleOutlined(tile, p.x1, p.y1, p.radius, p.color, TFT_WHITE);
+            break;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef GAME2_PINBALL_TABLE_H
+#define GAME2_PINBALL_TABLE_H
+
+#include <M5Stack.h>
+#include "../engine/raster.h"
+
+// Pinball table geometry, loaded from a text file and indexed by a
+// bounding-volume hierarchy so each ball step only tests nearby shapes.
+//
+// Table file format, one primitive per line ('#' starts a comment):
+//   wall   x1 y1 x2 y2 [color]               one-sided, playfield on the right
+//                                            when walking from (x1,y1) to (x2,y2);
+//                                            drawn 2 px thick, WHITE by default
+//   seg    x1 y1 x2 y2 color [kick] [value]  two-sided guide / slingshot
+//   arc    cx cy r a0 a1 color               two-sided arc, angles in degrees
+//   bumper x y r color value                 round pop bumper
+//   flipper left|right x y                   flipper pivot
+// Colors are names (RED, CYAN, ...) or numbers (0xF800). Zero-length walls
+// and segments are skipped.
+
+#define MAX_TABLE_PRIMS 64
+#define TABLE_PATH "/pinball/table.txt"
+#define TABLE_FAR 1000.0       // Distance reported when a primitive is out of reach
+#define TABLE_BOOST_SPEED 12.0 // A boost never takes a ball past this, px per 20 ms tick
+
+enum TablePrimType : uint8_t {
+    PRIM_WALL = 0,
+    PRIM_SEGMENT,
+    PRIM_ARC,
+    PRIM_BUMPER
+};
+
+struct TablePrim {
+    TablePrimType type;
+    int16_t x1, y1, x2, y2;    // Segment endpoints, or centre in x1/y1
+    int16_t radius;            // Arc and bumper radius
+    int16_t a0, a1;            // Arc start/end angle in degrees
+    uint16_t color;
+    float restitution;         // Normal velocity kept after a bounce
+    float boost;               // Speed multiplier on hit (bumpers, slingshots), up
+                               // to TABLE_BOOST_SPEED
+    int value;                 // Score per hit
+    int16_t minX, minY, maxX, maxY;
+};
+
+struct TableNode {
+    int16_t minX, minY, maxX, maxY;
+    uint8_t first;             // Leaf: first index into primOrder
+    uint8_t count;             // Leaf: primitive count, 0 for inner nodes
+    uint8_t right;             // Inner: right child (left child is next node)
+};
+
+struct PinballTable {
+    TablePrim prims[MAX_TABLE_PRIMS];
+    int primCount;
+    TableNode nodes[2 * MAX_TABLE_PRIMS];
+    int nodeCount;
+    uint8_t primOrder[MAX_TABLE_PRIMS];
+    int16_t leftFlipperX, leftFlipperY;
+    int16_t rightFlipperX, rightFlipperY;
+};
+
+// Load TABLE_PATH from SD, falling back to the built-in table when there is
+// no file, it doesn't parse, or it is too big to read whole
+void loadTable(PinballTable &table);
+bool parseTable(PinballTable &table, const char *text);
+void buildTableBVH(PinballTable &table);
+
+// Collect primitives whose bounds overlap the box, returns the count. Stops
+// at maxOut, so callers pass MAX_TABLE_PRIMS to be sure of seeing them all.
+int queryTable(const PinballTable &table, int16_t minX, int16_t minY,
+               int16_t maxX, int16_t maxY, uint8_t *out, int maxOut);
+
+// Push a ball of the given radius out of a primitive and bounce it.
+// Returns true on contact.
+bool collideTablePrim(const TablePrim &p, float radius,
+                      float &x, float &y, float &vx, float &vy);
+
+// Apply a contact found elsewhere: push out by depth along the outward
+// normal and bounce with the primitive's restitution and boost
+bool bounceOffTablePrim(const TablePrim &p, float nx, float ny, float depth,
+                        float &x, float &y, float &vx, float &vy);
+
+// Signed distance from a point to the primitive surface, negative inside
+// solid geometry, with the outward normal at the closest point
+float tablePrimDistance(const TablePrim &p, float x, float y, float &nx, float &ny);
+
+// Draw the primitive into the tile, clipped to it. Segments and arcs get
+// the same pixels M5.Lcd.drawLine would give them.
+void drawTablePrimTile(const TablePrim &p, RasterTile &tile);
+
+#endif
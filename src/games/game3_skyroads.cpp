@@ -1,4 +1,13 @@
 #include "game3_skyroads.h"
+#include "game3_skyroads_track.h"
+#include "../engine/particles.h"
+#include "../engine/title_screen.h"
+#include "../engine/arena.h"
+#include "../engine/display_list.h"
+#include "../engine/lcd_batch.h"
+#include "../engine/font_cache.h"
+#include "../engine/quality_governor.h"
+#include "../engine/screen_capture.h"
 #include <Wire.h>
 
 // Faces GameBoy I2C address
@@ -8,12 +17,22 @@
 #define SCREEN_WIDTH 320
 #define SCREEN_HEIGHT 240
 #define TRACK_ROWS 12
-#define TRACK_LANES 5
+#define TILE_HEIGHT 15
 #define BASE_SPEED 3.0
 #define BOOST_SPEED 6.0
 #define BRAKE_SPEED 1.5
+#define LANE_STEP 0.2          // Lanes moved per tick
 #define JUMP_DURATION 20
+#define JUMP_HEIGHT 14         // Peak of the jump arc in pixels
 #define BOOST_DURATION 30
+#define STAR_COUNT 40
+#define STAR_LAYERS 3          // Nearer layers drift faster
+#define CRASH_DEBRIS 24
+#define CRASH_DEBRIS_LIFE 20
+#define SIM_TICK_MS 40         // Simulation rate; rendering blends between ticks
+#define MAX_TICKS_PER_FRAME 4  // Drop time rather than spiral after a stall
+#define TITLE_MS 3500
+#define INVULNERABLE_MS 1000   // Grace after a hit
 
 // Custom colors
 #define TFT_DARKBLUE 0x0010
@@ -21,14 +40,25 @@
 #define TFT_DARKGRAY 0x39E7
 #define TFT_SPACE 0x0008
 
-// Tile types
-enum TileType {
-    TILE_NORMAL = 0,
-    TILE_SPEED,
-    TILE_DEADLY,
-    TILE_JUMP,
-    TILE_GAP
-};
+// Screen area drawn through the display list, horizon down to the HUD
+#define PLAYFIELD_Y 30
+#define PLAYFIELD_HEIGHT (SCREEN_HEIGHT - 45)
+
+// Quality levels, each dropping what the one before it did and more
+#define QUALITY_FEWER_STARS 1      // Half the starfield
+#define QUALITY_FEWER_PARTICLES 2  // Half the crash debris
+#define QUALITY_HUD_HALF_RATE 3    // HUD redrawn every other frame
+#define QUALITY_NO_BORDERS 4       // Tiles without their depth borders
+#define QUALITY_NO_BLEND 5         // Frames only after ticks, not blended between
+#define QUALITY_LEVELS 6
+
+#define HALF_RES 0             // Start at half resolution; Start swaps during play
+#define TRACK_SEED 0           // Nonzero replays the same track every game
+
+// The track generator's solvability guarantee rests on these
+static_assert(TRACK_ROW_TICKS * BASE_SPEED == TILE_HEIGHT, "row time out of date");
+static_assert(TRACK_ROW_TICKS * LANE_STEP >= TRACK_LANES_PER_ROW - 0.001, "lane speed out of date");
+static_assert((JUMP_DURATION - 1) / TRACK_ROW_TICKS == TRACK_JUMP_ROWS, "jump length out of date");
 
 // Track tile structure
 struct Tile {
@@ -42,12 +72,26 @@ struct Ship {
     float targetLane;    // Target lane for smooth transition
     bool jumping;
     int jumpCounter;
+    float jumpHeight;    // Pixels above the road
     uint16_t color;
 };
 
+// Simulation values the renderer blends between ticks
+struct ShipFrame {
+    float lane;
+    float jumpHeight;
+    float travel;        // Pixels scrolled since the start
+};
+
 // Game state
 static Ship ship;
-static Tile track[TRACK_ROWS][TRACK_LANES];
+static Tile (*track)[TRACK_LANES];     // TRACK_ROWS rows, in the arena
+static Tile passedRow[TRACK_LANES];    // Front row before the last shift, for blending
+static TrackGenerator *trackGen;
+static TrackLevel level;
+static bool levelMode = false;   // Play the authored level instead of generated track
+static bool levelComplete = false;
+static int finishRows = 0;       // Rows until the end of the level reaches the ship
 static float scrollOffset = 0.0;
 static float currentSpeed = BASE_SPEED;
 static int boostCounter = 0;
@@ -56,10 +100,32 @@ static int distance = 0;
 static int lives = 3;
 static bool gameOver = false;
 static uint8_t facesData = 0xFF;
-static int invulnerable = 0;  // Invulnerability frames after hit
+static int invulnerable = 0;  // Invulnerable sim ticks left after a hit
+static ParticlePool *stars;
+static ParticlePool *effects;    // Crash debris
+static bool needsFullRedraw = true;
+static TitleScreen title;
+static bool inTitle = false;
+static DisplayFrame *playfield;
+static FontCache *hudFont;       // Size 2 score line
+static FontCache *labelFont;     // Size 1 status line
+static ShipFrame prevFrame, currFrame;
+static unsigned long lastFrameTime = 0;
+static unsigned long simAccumulator = 0;
+static bool pendingLeft = false;    // Presses latched between ticks
+static bool pendingRight = false;
+static bool pendingJump = false;
+static QualityGovernor quality;
+static int hudFrame = 0;
+static bool halfRes = HALF_RES;
+static bool startHeld = false;    // So a Start press from game over doesn't carry in
+
+const uint16_t STAR_COLORS[STAR_LAYERS] = { TFT_DARKGRAY, TFT_GRAY, TFT_WHITE };
 
 // Forward declarations
 void checkCollision();
+static void simulationTick();
+static void renderFrame(float alpha);
 
 static void readFacesButtons() {
     Wire.requestFrom(FACES_ADDR, 1);
@@ -79,64 +145,78 @@ uint16_t getTileColor(TileType type) {
     }
 }
 
-void generateTrackRow(int row) {
-    // Generate random track with patterns
-    for (int lane = 0; lane < TRACK_LANES; lane++) {
-        int rand_val = random(100);
-
-        if (rand_val < 60) {
-            track[row][lane].type = TILE_NORMAL;
-        } else if (rand_val < 70) {
-            track[row][lane].type = TILE_SPEED;
-        } else if (rand_val < 80) {
-            track[row][lane].type = TILE_JUMP;
-        } else if (rand_val < 88) {
-            track[row][lane].type = TILE_DEADLY;
-        } else {
-            track[row][lane].type = TILE_GAP;
+static void loadTrackRow(int row) {
+    TrackRow next;
+    if (!levelMode) {
+        nextTrackRow(*trackGen, next);
+    } else if (!nextLevelRow(level, next)) {
+        // Past the end of the level: pave a run-out and start the countdown
+        for (int lane = 0; lane < TRACK_LANES; lane++) {
+            next.tiles[lane] = TILE_NORMAL;
         }
-
-        track[row][lane].color = getTileColor(track[row][lane].type);
+        if (finishRows == 0) finishRows = TRACK_ROWS;
     }
-
-    // Ensure at least 2 safe tiles per row (no impossible situations)
-    int safeCount = 0;
     for (int lane = 0; lane < TRACK_LANES; lane++) {
-        if (track[row][lane].type == TILE_NORMAL ||
-            track[row][lane].type == TILE_SPEED ||
-            track[row][lane].type == TILE_JUMP) {
-            safeCount++;
-        }
-    }
-
-    if (safeCount < 2) {
-        // Make first two lanes safe
-        track[row][0].type = TILE_NORMAL;
-        track[row][0].color = getTileColor(TILE_NORMAL);
-        track[row][1].type = TILE_NORMAL;
-        track[row][1].color = getTileColor(TILE_NORMAL);
+        track[row][lane].type = next.tiles[lane];
+        track[row][lane].color = getTileColor(next.tiles[lane]);
     }
 }
 
 void initializeTrack() {
-    for (int row = 0; row < TRACK_ROWS; row++) {
-        generateTrackRow(row);
+    finishRows = 0;
+    if (levelMode) {
+        closeTrackLevel(level);
+        openTrackLevel(level);
+    } else {
+        uint32_t seed = TRACK_SEED ? TRACK_SEED : random(1, 0x7FFFFFFF);
+        initTrackGenerator(*trackGen, seed, TRACK_LANES / 2);
     }
 
-    // Make first 3 rows all normal for safe start
-    for (int row = 0; row < 3; row++) {
-        for (int lane = 0; lane < TRACK_LANES; lane++) {
-            track[row][lane].type = TILE_NORMAL;
-            track[row][lane].color = getTileColor(TILE_NORMAL);
-        }
+    for (int row = 0; row < TRACK_ROWS; row++) {
+        loadTrackRow(row);
     }
+    if (!levelMode) generateTrackChunk(*trackGen);
+}
+
+static int starTarget() {
+    return quality.level >= QUALITY_FEWER_STARS ? STAR_COUNT / 2 : STAR_COUNT;
+}
+
+static void spawnStar() {
+    int layer = particleRandom(*stars) % STAR_LAYERS;
+    int x = particleRandom(*stars) % SCREEN_WIDTH;
+    int y = 31 + particleRandom(*stars) % (SCREEN_HEIGHT - 71);
+    // Speed per unit of currentSpeed, in 8.8
+    int vy = (layer + 1) * PARTICLE_ONE / 8;
+    spawnParticle(*stars, x, y, 0, vy, STAR_COLORS[layer], PARTICLE_FOREVER);
+}
+
+// Match the starfield to the quality level. Stars are drawn through the
+// display list, so ones dropped off the end need no erasing.
+static void applyQuality() {
+    stars->count = min(stars->count, starTarget());
+    while (stars->count < starTarget()) spawnStar();
+}
+
+static void initStarfield() {
+    initParticles(*stars, 0, 31, SCREEN_WIDTH, SCREEN_HEIGHT - 40, true, random(1, 0x7FFFFFFF));
+    while (stars->count < starTarget()) spawnStar();
+
+    initParticles(*effects, 0, 31, SCREEN_WIDTH, SCREEN_HEIGHT - 15, false, stars->seed);
+}
+
+static void captureFrame(ShipFrame &frame) {
+    frame.lane = ship.lane;
+    frame.jumpHeight = ship.jumpHeight;
+    frame.travel = distance * TILE_HEIGHT + scrollOffset;
 }
 
 static void resetGame() {
-    ship.lane = TRACK_LANES / 2.0;
+    ship.lane = TRACK_LANES / 2;
     ship.targetLane = ship.lane;
     ship.jumping = false;
     ship.jumpCounter = 0;
+    ship.jumpHeight = 0;
     ship.color = TFT_YELLOW;
 
     scrollOffset = 0.0;
@@ -146,82 +226,92 @@ static void resetGame() {
     distance = 0;
     lives = 3;
     gameOver = false;
+    levelComplete = false;
     invulnerable = 0;
 
     initializeTrack();
+    memcpy(passedRow, track[0], sizeof(passedRow));
+    initStarfield();
+    needsFullRedraw = true;
+    startHeld = !(facesData & 0x80);
+
+    captureFrame(currFrame);
+    prevFrame = currFrame;
+    lastFrameTime = millis();
+    simAccumulator = 0;
+    pendingLeft = pendingRight = pendingJump = false;
 }
 
-void drawTile(int row, int lane, uint16_t color) {
+// Record one row of tiles pushed scroll pixels toward the viewer
+void recordTrackRow(DisplayList &list, int row, const Tile *tiles, float scroll) {
     // Calculate perspective dimensions
-    float rowProgress = (float)row / (TRACK_ROWS - 1);
+    float rowProgress = (row - scroll / TILE_HEIGHT) / (TRACK_ROWS - 1);
 
     // Y position (from bottom to top of screen)
-    int yBottom = SCREEN_HEIGHT - 40 - row * 15;
-    int yTop = yBottom - 14;
+    int yBottom = SCREEN_HEIGHT - 40 - row * TILE_HEIGHT + (int)scroll;
+    int yTop = max(yBottom - (TILE_HEIGHT - 1), 31);
 
-    if (yTop < 30) return;  // Don't draw beyond horizon
+    if (yBottom < 31) return;  // Don't draw beyond horizon
 
     // X position with perspective narrowing
     float trackWidthAtRow = 280 - rowProgress * 180;  // Track narrows into distance
     float laneWidth = trackWidthAtRow / TRACK_LANES;
     float trackLeft = (SCREEN_WIDTH - trackWidthAtRow) / 2;
+    int height = yBottom - yTop + 1;
 
-    int xLeft = trackLeft + lane * laneWidth;
-    int xRight = trackLeft + (lane + 1) * laneWidth;
-
-    // Draw tile
-    M5.Lcd.fillRect(xLeft + 1, yTop, xRight - xLeft - 2, yBottom - yTop, color);
-
-    // Draw tile border for depth
-    M5.Lcd.drawRect(xLeft, yTop, xRight - xLeft, yBottom - yTop, TFT_DARKGRAY);
-}
+    for (int lane = 0; lane < TRACK_LANES; lane++) {
+        int xLeft = trackLeft + lane * laneWidth;
+        int xRight = trackLeft + (lane + 1) * laneWidth;
 
-void drawTrack() {
-    // Draw space background
-    M5.Lcd.fillRect(0, 30, SCREEN_WIDTH, SCREEN_HEIGHT - 70, TFT_SPACE);
+        // Draw tile
+        recordFillRect(list, xLeft + 1, yTop, xRight - xLeft - 2, height, tiles[lane].color);
 
-    // Draw stars (simple)
-    for (int i = 0; i < 30; i++) {
-        int sx = random(SCREEN_WIDTH);
-        int sy = random(30, SCREEN_HEIGHT - 40);
-        M5.Lcd.drawPixel(sx, sy, TFT_WHITE);
+        // Draw tile border for depth
+        if (quality.level < QUALITY_NO_BORDERS) {
+            recordRect(list, xLeft, yTop, xRight - xLeft, height, TFT_DARKGRAY);
+        }
     }
+}
 
-    // Draw horizon line
-    M5.Lcd.drawLine(0, 30, SCREEN_WIDTH, 30, TFT_DARKBLUE);
+// The whole background goes in every frame; the display list works out
+// which parts of it are uncovered and have changed. rowOffset is -1 while
+// blending back across a row the last tick shifted off the front.
+void recordTrack(DisplayList &list, int rowOffset, float scroll) {
+    // Space background and horizon line
+    recordFillRect(list, 0, 31, SCREEN_WIDTH, SCREEN_HEIGHT - 46, TFT_SPACE);
+    recordFillRect(list, 0, 30, SCREEN_WIDTH, 1, TFT_DARKBLUE);
+    recordParticles(*stars, list);
 
     // Draw all tiles from back to front
     for (int row = TRACK_ROWS - 1; row >= 0; row--) {
-        for (int lane = 0; lane < TRACK_LANES; lane++) {
-            drawTile(row, lane, track[row][lane].color);
-        }
+        int source = row + rowOffset;
+        recordTrackRow(list, row, source < 0 ? passedRow : track[source], scroll);
     }
 }
 
-void drawShip() {
-    // Calculate ship position on screen
+static int shipScreenX(float lane) {
     float rowProgress = 1.0 / (TRACK_ROWS - 1);
     float trackWidthAtShip = 280 - rowProgress * 180;
     float laneWidth = trackWidthAtShip / TRACK_LANES;
     float trackLeft = (SCREEN_WIDTH - trackWidthAtShip) / 2;
 
-    int shipX = trackLeft + ship.lane * laneWidth + laneWidth / 2;
+    return trackLeft + lane * laneWidth + laneWidth / 2;
+}
+
+void recordShip(DisplayList &list, float lane, float jumpHeight) {
+    // Calculate ship position on screen
+    int shipX = shipScreenX(lane);
     int shipY = SCREEN_HEIGHT - 55;
 
     // Draw ship as a triangle/arrow
     int shipSize = 12;
+    bool airborne = jumpHeight >= 1;
 
-    // Jump offset
-    int jumpOffset = 0;
-    if (ship.jumping) {
-        jumpOffset = -10;
-    }
-
-    shipY += jumpOffset;
+    shipY -= (int)(jumpHeight + 0.5);
 
     // Draw ship shadow if jumping
-    if (ship.jumping) {
-        M5.Lcd.fillTriangle(
+    if (airborne) {
+        recordFillTriangle(list,
             shipX, SCREEN_HEIGHT - 55 + 5,
             shipX - shipSize/2, SCREEN_HEIGHT - 55 + shipSize + 5,
             shipX + shipSize/2, SCREEN_HEIGHT - 55 + shipSize + 5,
@@ -235,7 +325,7 @@ void drawShip() {
     }
 
     // Draw ship body (triangle pointing forward/up)
-    M5.Lcd.fillTriangle(
+    recordFillTriangle(list,
         shipX, shipY,
         shipX - shipSize/2, shipY + shipSize,
         shipX + shipSize/2, shipY + shipSize,
@@ -243,62 +333,87 @@ void drawShip() {
     );
 
     // Draw ship cockpit
-    M5.Lcd.fillCircle(shipX, shipY + 6, 3, TFT_CYAN);
+    recordFillCircle(list, shipX, shipY + 6, 3, TFT_CYAN);
 
     // Draw exhaust flames
-    if (!ship.jumping) {
-        M5.Lcd.fillRect(shipX - 2, shipY + shipSize, 4, 4, TFT_ORANGE);
-        M5.Lcd.fillRect(shipX - 1, shipY + shipSize + 4, 2, 2, TFT_RED);
+    if (!airborne) {
+        recordFillRect(list, shipX - 2, shipY + shipSize, 4, 4, TFT_ORANGE);
+        recordFillRect(list, shipX - 1, shipY + shipSize + 4, 2, 2, TFT_RED);
     }
 }
 
-void updateShip() {
-    M5.update();
-    readFacesButtons();
-
+// Latch presses from facesData, plus a held jump from elsewhere
+static void latchShipInput(bool jumpHeld) {
     bool facesLeft = !(facesData & 0x04);
     bool facesRight = !(facesData & 0x08);
     bool facesUp = !(facesData & 0x01);
-    bool facesDown = !(facesData & 0x02);
     bool facesA = !(facesData & 0x10);
-    bool facesB = !(facesData & 0x20);
+    bool jumpPressed = facesA || facesUp || jumpHeld;
 
     static bool lastLeft = false;
     static bool lastRight = false;
     static bool lastJump = false;
-    static bool lastBoost = false;
 
-    // Lane movement
-    if ((facesLeft && !lastLeft) || M5.BtnA.wasPressed()) {
-        if (ship.targetLane > 0) {
-            ship.targetLane--;
-        }
-    }
-    if ((facesRight && !lastRight) || M5.BtnC.wasPressed()) {
-        if (ship.targetLane < TRACK_LANES - 1) {
-            ship.targetLane++;
-        }
-    }
+    if (facesLeft && !lastLeft) pendingLeft = true;
+    if (facesRight && !lastRight) pendingRight = true;
+    if (jumpPressed && !lastJump) pendingJump = true;
 
     lastLeft = facesLeft;
     lastRight = facesRight;
+    lastJump = jumpPressed;
+}
+
+// Poll every frame and latch presses, so none are lost when a frame runs
+// no simulation tick
+static void readShipInput() {
+    M5.update();
+    readFacesButtons();
+    latchShipInput(M5.BtnB.isPressed());
+    if (M5.BtnA.wasPressed()) pendingLeft = true;
+    if (M5.BtnC.wasPressed()) pendingRight = true;
+
+    bool facesStart = !(facesData & 0x80);
+    if (facesStart && !startHeld) {
+        halfRes = !halfRes;
+        setDisplayFrameHalfRes(*playfield, halfRes);
+        // The half-resolution grid paints one row past the playfield
+        if (!halfRes) {
+            M5.Lcd.fillRect(0, PLAYFIELD_Y + PLAYFIELD_HEIGHT, SCREEN_WIDTH, 1, TFT_BLACK);
+            if (capturing()) captureRect(0, PLAYFIELD_Y + PLAYFIELD_HEIGHT, SCREEN_WIDTH, 1);
+        }
+    }
+    startHeld = facesStart;
+}
+
+void updateShip() {
+    bool facesDown = !(facesData & 0x02);
+    bool facesB = !(facesData & 0x20);
+
+    // Lane movement
+    if (pendingLeft && ship.targetLane > 0) {
+        ship.targetLane--;
+    }
+    if (pendingRight && ship.targetLane < TRACK_LANES - 1) {
+        ship.targetLane++;
+    }
+    pendingLeft = false;
+    pendingRight = false;
 
     // Smooth lane transition
     if (ship.lane < ship.targetLane) {
-        ship.lane += 0.2;
+        ship.lane += LANE_STEP;
         if (ship.lane > ship.targetLane) ship.lane = ship.targetLane;
     } else if (ship.lane > ship.targetLane) {
-        ship.lane -= 0.2;
+        ship.lane -= LANE_STEP;
         if (ship.lane < ship.targetLane) ship.lane = ship.targetLane;
     }
 
     // Jump
-    bool jumpPressed = facesA || facesUp || M5.BtnB.isPressed();
-    if (jumpPressed && !lastJump && !ship.jumping) {
+    if (pendingJump && !ship.jumping) {
         ship.jumping = true;
         ship.jumpCounter = JUMP_DURATION;
     }
-    lastJump = jumpPressed;
+    pendingJump = false;
 
     if (ship.jumping) {
         ship.jumpCounter--;
@@ -307,6 +422,14 @@ void updateShip() {
         }
     }
 
+    // Parabolic arc over the jump
+    if (ship.jumping) {
+        float t = (float)(JUMP_DURATION - ship.jumpCounter) / JUMP_DURATION;
+        ship.jumpHeight = 4 * JUMP_HEIGHT * t * (1 - t);
+    } else {
+        ship.jumpHeight = 0;
+    }
+
     // Speed control
     if (facesB && boostCounter == 0) {
         boostCounter = BOOST_DURATION;
@@ -331,23 +454,29 @@ void scrollTrack() {
     scrollOffset += currentSpeed;
 
     // When scrolled a full tile
-    if (scrollOffset >= 15) {  // Tile height
-        scrollOffset -= 15;
+    if (scrollOffset >= TILE_HEIGHT) {
+        scrollOffset -= TILE_HEIGHT;
         distance++;
         score += 10;
 
-        // Shift all rows down
+        // Shift all rows down, keeping the one that leaves for the renderer
+        memcpy(passedRow, track[0], sizeof(passedRow));
         for (int row = 0; row < TRACK_ROWS - 1; row++) {
             for (int lane = 0; lane < TRACK_LANES; lane++) {
                 track[row][lane] = track[row + 1][lane];
             }
         }
 
-        // Generate new row at the back
-        generateTrackRow(TRACK_ROWS - 1);
+        // Take the next row at the back
+        loadTrackRow(TRACK_ROWS - 1);
 
         // Check collision with new front row (row 0)
         checkCollision();
+
+        if (finishRows > 0 && --finishRows == 0 && !gameOver) {
+            levelComplete = true;
+            gameOver = true;
+        }
     }
 }
 
@@ -362,8 +491,11 @@ void checkCollision() {
     switch (currentTile) {
         case TILE_DEADLY:
             // Hit deadly tile
+            spawnParticleBurst(*effects, shipScreenX(ship.lane), SCREEN_HEIGHT - 49, 2 * PARTICLE_ONE,
+                               quality.level >= QUALITY_FEWER_PARTICLES ? CRASH_DEBRIS / 2 : CRASH_DEBRIS,
+                               TFT_ORANGE, CRASH_DEBRIS_LIFE);
             lives--;
-            invulnerable = 60;  // 1 second of invulnerability
+            invulnerable = INVULNERABLE_MS / SIM_TICK_MS;
             if (lives <= 0) {
                 gameOver = true;
             }
@@ -372,7 +504,7 @@ void checkCollision() {
         case TILE_GAP:
             // Fell into gap
             lives--;
-            invulnerable = 60;
+            invulnerable = INVULNERABLE_MS / SIM_TICK_MS;
             if (lives <= 0) {
                 gameOver = true;
             }
@@ -399,42 +531,31 @@ void checkCollision() {
     }
 }
 
+// Text is opaque and padded to a fixed width, so the HUD strips are
+// never cleared and don't flicker
 void drawHUD() {
-    M5.Lcd.fillRect(0, 0, SCREEN_WIDTH, 25, TFT_BLACK);
-    M5.Lcd.setTextSize(2);
-    M5.Lcd.setTextColor(TFT_WHITE, TFT_BLACK);
-
-    M5.Lcd.setCursor(5, 5);
-    M5.Lcd.print("Score:");
-    M5.Lcd.print(score);
-
-    M5.Lcd.setCursor(180, 5);
-    M5.Lcd.print("Dist:");
-    M5.Lcd.print(distance);
-
-    M5.Lcd.setCursor(290, 5);
-    M5.Lcd.print(lives);
+    char text[16];
+    snprintf(text, sizeof(text), "Score:%-6d", score);
+    drawCachedText(*hudFont, 5, 5, text, TFT_WHITE, TFT_BLACK);
+    snprintf(text, sizeof(text), "Dist:%-3d", distance);
+    drawCachedText(*hudFont, 180, 5, text, TFT_WHITE, TFT_BLACK);
+    snprintf(text, sizeof(text), "%d", lives);
+    drawCachedText(*hudFont, 290, 5, text, TFT_WHITE, TFT_BLACK);
 
     // Speed indicator
-    M5.Lcd.fillRect(0, SCREEN_HEIGHT - 15, SCREEN_WIDTH, 15, TFT_BLACK);
-    M5.Lcd.setTextSize(1);
-    M5.Lcd.setCursor(5, SCREEN_HEIGHT - 12);
-    M5.Lcd.setTextColor(TFT_CYAN, TFT_BLACK);
-
+    const char *speed = "NORMAL  ";
     if (boostCounter > 0) {
-        M5.Lcd.print("BOOST!");
+        speed = "BOOST!  ";
     } else if (currentSpeed > BASE_SPEED) {
-        M5.Lcd.print("SPEED UP");
+        speed = "SPEED UP";
     } else if (currentSpeed < BASE_SPEED) {
-        M5.Lcd.print("BRAKING");
-    } else {
-        M5.Lcd.print("NORMAL");
+        speed = "BRAKING ";
     }
+    drawCachedText(*labelFont, 5, SCREEN_HEIGHT - 12, speed, TFT_CYAN, TFT_BLACK);
 
     // Controls hint
-    M5.Lcd.setCursor(SCREEN_WIDTH - 120, SCREEN_HEIGHT - 12);
-    M5.Lcd.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    M5.Lcd.print("L/R:Move A:Jump");
+    drawCachedText(*labelFont, SCREEN_WIDTH - 120, SCREEN_HEIGHT - 12, "L/R:Move A:Jump",
+                   TFT_LIGHTGREY, TFT_BLACK);
 }
 
 void game3Setup() {
@@ -461,20 +582,67 @@ void game3Setup() {
     M5.Lcd.setCursor(40, 200);
     M5.Lcd.setTextColor(TFT_YELLOW);
     M5.Lcd.println("Avoid red tiles and gaps!");
-
-    delay(3500);
-
+    M5.Lcd.setCursor(40, 215);
+    M5.Lcd.setTextColor(TFT_LIGHTGREY);
+    M5.Lcd.println("A: play the level");
+
+    track = arenaArray<Tile[TRACK_LANES]>(TRACK_ROWS);
+    trackGen = arenaArray<TrackGenerator>(1);
+    stars = arenaArray<ParticlePool>(1);
+    effects = arenaArray<ParticlePool>(1);
+    playfield = arenaArray<DisplayFrame>(1);
+    hudFont = arenaArray<FontCache>(1);
+    labelFont = arenaArray<FontCache>(1);
+    cacheFont(*hudFont, "Score:Dist0123456789 ", 2);
+    cacheFont(*labelFont, "BOOST!SPEED UPBRAKINGNORMALL/:MoveA:Jump ", 1);
+    initDisplayFrame(*playfield, 0, PLAYFIELD_Y, SCREEN_WIDTH, PLAYFIELD_HEIGHT);
+    setDisplayFrameHalfRes(*playfield, halfRes);
+    initQualityGovernor(quality, GAME3_FRAME_MS, QUALITY_LEVELS - 1);
+
+    // Get an endless game ready and fill its row queue behind the title
     randomSeed(analogRead(0));
+    levelMode = false;
     resetGame();
+
+    readFacesButtons();
+    startTitle(title, TITLE_MS, ~facesData);
+    inTitle = true;
+}
+
+void game3Teardown() {
+    closeTrackLevel(level);
 }
 
 void game3Loop() {
+    if (inTitle) {
+        uint32_t sliceStart = millis();
+        while (trackGen->count < TRACK_QUEUE_ROWS && titleSliceLeft(sliceStart)) {
+            generateTrackChunk(*trackGen);
+        }
+        readFacesButtons();
+        if (!updateTitle(title, ~facesData, trackGen->count == TRACK_QUEUE_ROWS)) return;
+        inTitle = false;
+
+        // Pressing A, or still holding it at the end, picks the authored level
+        if ((title.skipped & 0x10) || !(facesData & 0x10)) {
+            levelMode = true;
+            resetGame();
+        }
+        lastFrameTime = millis();
+    }
+
     if (gameOver) {
         M5.Lcd.fillScreen(TFT_BLACK);
         M5.Lcd.setTextSize(3);
-        M5.Lcd.setTextColor(TFT_RED);
-        M5.Lcd.setCursor(50, 70);
-        M5.Lcd.println("GAME OVER");
+        if (levelComplete) {
+            M5.Lcd.setTextColor(TFT_GREEN);
+            M5.Lcd.setCursor(30, 70);
+            M5.Lcd.println("LEVEL CLEAR");
+        } else {
+            M5.Lcd.setTextColor(TFT_RED);
+            M5.Lcd.setCursor(50, 70);
+            M5.Lcd.println("GAME OVER");
+        }
 
         M5.Lcd.setTextSize(2);
         M5.Lcd.setTextColor(TFT_YELLOW);
@@ -490,28 +658,101 @@ void game3Loop() {
         M5.Lcd.setCursor(50, 170);
         M5.Lcd.println("B: Play Again");
         M5.Lcd.setCursor(50, 185);
+        M5.Lcd.println(levelMode ? "Start: Switch to Endless" : "Start: Switch to Level");
+        M5.Lcd.setCursor(50, 200);
         M5.Lcd.println("Select: Menu");
+        if (capturing()) captureRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
         M5.update();
         readFacesButtons();
         bool facesB = !(facesData & 0x20);
+        bool facesStart = !(facesData & 0x80);
         static bool lastB = false;
+        static bool lastStart = false;
 
-        if (facesB && !lastB) {
+        if (facesStart && !lastStart) {
+            levelMode = !levelMode;
+            resetGame();
+        } else if (facesB && !lastB) {
             resetGame();
         }
         lastB = facesB;
+        lastStart = facesStart;
 
         delay(50);
         return;
     }
 
+    unsigned long frameStart = millis();
+    uint32_t workStart = micros();
+    simAccumulator += min(frameStart - lastFrameTime,
+                          (unsigned long)(MAX_TICKS_PER_FRAME * SIM_TICK_MS));
+    lastFrameTime = frameStart;
+
+    readShipInput();
+    int ticks = 0;
+    while (simAccumulator >= SIM_TICK_MS && !gameOver) {
+        simAccumulator -= SIM_TICK_MS;
+        simulationTick();
+        ticks++;
+    }
+
+    // Blend the last two ticks by how far we are into the next one, or at
+    // the lowest quality draw each tick once as it is
+    if (quality.level < QUALITY_NO_BLEND) {
+        renderFrame((float)simAccumulator / SIM_TICK_MS);
+    } else if (ticks > 0) {
+        renderFrame(1.0);
+    }
+
+    // Only frames that drew anything say how long drawing takes
+    if ((quality.level < QUALITY_NO_BLEND || ticks > 0) &&
+        updateQualityGovernor(quality, micros() - workStart)) {
+        applyQuality();
+    }
+
+    // Generate track ahead while the frame has time to spare
+    if (!levelMode) generateTrackChunk(*trackGen);
+
+    unsigned long elapsed = millis() - frameStart;
+    if (elapsed < GAME3_FRAME_MS) {
+        delay(GAME3_FRAME_MS - elapsed);
+    }
+}
+
+static void simulationTick() {
+    prevFrame = currFrame;
+
     updateShip();
     scrollTrack();
+    updateParticles(*stars, currentSpeed * PARTICLE_ONE);
+    updateParticles(*effects, PARTICLE_ONE);
 
-    drawTrack();
-    drawShip();
-    drawHUD();
+    captureFrame(currFrame);
+}
 
-    delay(30);
+static void renderFrame(float alpha) {
+    float lane = prevFrame.lane + (currFrame.lane - prevFrame.lane) * alpha;
+    float jumpHeight = prevFrame.jumpHeight + (currFrame.jumpHeight - prevFrame.jumpHeight) * alpha;
+    float travel = prevFrame.travel + (currFrame.travel - prevFrame.travel) * alpha;
+
+    // Whole rows come from the row count, the remainder is the scroll.
+    // Blending back across a shift lands one row behind the current track.
+    float rows = floorf(travel / TILE_HEIGHT);
+    int rowOffset = constrain((int)rows - distance, -1, 0);
+    float scroll = travel - rows * TILE_HEIGHT;
+
+    if (needsFullRedraw) {
+        invalidateDisplayFrame(*playfield);
+        needsFullRedraw = false;
+        hudFrame = 0;
+    }
+    beginLcdFrame();
+    DisplayList &list = beginDisplayFrame(*playfield);
+    recordTrack(list, rowOffset, scroll);
+    recordShip(list, lane, jumpHeight);
+    recordParticles(*effects, list);
+    renderDisplayFrame(*playfield);
+    if (quality.level < QUALITY_HUD_HALF_RATE || (hudFrame++ & 1) == 0) drawHUD();
+    endLcdFrame();
 }
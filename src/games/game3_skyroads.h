@@ -3,7 +3,10 @@
 
 #include <M5Stack.h>
 
+#define GAME3_FRAME_MS 20     // What the loop paces itself to
+
 void game3Setup();
 void game3Loop();
+void game3Teardown();
 
 #endif
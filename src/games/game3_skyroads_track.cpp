@@ -0,0 +1,279 @@
+#include "game3_skyroads_track.h"
+
+#define LEVEL_LINE_LENGTH 48
+
+// Built-in level, used when no level file is on the SD card
+static const char DEFAULT_LEVEL[] =
+    "# Warm up\n"
+    "24 .....\n"
+    "6 s...s\n"
+    "10 ._._.\n"
+    "6 .....\n"
+    "# Narrowing\n"
+    "8 x...x\n"
+    "8 xx.xx\n"
+    "4 x...x\n"
+    "8 .....\n"
+    "# First gaps\n"
+    "2 _____\n"
+    "8 .....\n"
+    "3 _____\n"
+    "10 .....\n"
+    "# Weave\n"
+    "4 .xxxx\n"
+    "4 ..xxx\n"
+    "4 x..xx\n"
+    "4 xx..x\n"
+    "4 xxx..\n"
+    "4 xx..x\n"
+    "4 x..xx\n"
+    "4 ..xxx\n"
+    "8 .....\n"
+    "# Launch pads\n"
+    "1 jjjjj\n"
+    "3 _____\n"
+    "6 .....\n"
+    "1 ..j..\n"
+    "3 xxxxx\n"
+    "8 s...s\n"
+    "# Tunnel\n"
+    "120 x...x\n"
+    "40 xx.xx\n"
+    "120 x...x\n"
+    "10 .....\n"
+    "# Stepping stones\n"
+    "2 ._._.\n"
+    "2 _._._\n"
+    "2 ._._.\n"
+    "2 _._._\n"
+    "2 ._._.\n"
+    "10 .....\n"
+    "# Long hops\n"
+    "1 .....\n"
+    "3 _____\n"
+    "1 ..s..\n"
+    "3 _____\n"
+    "1 .....\n"
+    "3 _____\n"
+    "12 .....\n"
+    "# Slalom\n"
+    "6 ..xxx\n"
+    "6 x..xx\n"
+    "6 xx..x\n"
+    "6 xxx..\n"
+    "6 xx..x\n"
+    "6 x..xx\n"
+    "6 ..xxx\n"
+    "12 .....\n"
+    "# Speedway\n"
+    "150 sssss\n"
+    "40 s_s_s\n"
+    "150 sssss\n"
+    "# Closing tunnel\n"
+    "60 x...x\n"
+    "1 x.j.x\n"
+    "3 xxxxx\n"
+    "60 xx.xx\n"
+    "30 .....\n";
+
+// Frontier bit for a lane in a given ship state. FREE ships may land or
+// jump, LANDING ships must touch down on the next row, and AIRn ships
+// fly over the next n rows.
+enum ShipState {
+    STATE_FREE = 0,
+    STATE_LANDING,
+    STATE_AIR1,
+    STATE_AIR2,
+    STATE_AIR3,
+    TRACK_STATES
+};
+
+#define STATE_BIT(state, lane) (1UL << ((state) * TRACK_LANES + (lane)))
+#define STATE_MASK(state) (((1UL << TRACK_LANES) - 1) << ((state) * TRACK_LANES))
+
+static uint32_t nextRandom(TrackGenerator &gen) {
+    // xorshift32
+    uint32_t s = gen.rng;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    gen.rng = s;
+    return s;
+}
+
+// Lanes reachable from a set of lanes in one row
+static uint32_t spreadLanes(uint32_t lanes) {
+    const uint32_t all = (1UL << TRACK_LANES) - 1;
+    for (int n = 0; n < TRACK_LANES_PER_ROW; n++) {
+        lanes |= (lanes << 1) | (lanes >> 1);
+    }
+    return lanes & all;
+}
+
+static bool isLandable(TileType type) {
+    return type == TILE_NORMAL || type == TILE_SPEED || type == TILE_JUMP;
+}
+
+uint32_t advanceFrontier(uint32_t frontier, const TrackRow &row) {
+    uint32_t lanes[TRACK_STATES];
+    for (int s = 0; s < TRACK_STATES; s++) {
+        lanes[s] = spreadLanes((frontier & STATE_MASK(s)) >> (s * TRACK_LANES));
+    }
+
+    uint32_t next = 0;
+
+    // Airborne ships pass over this row whatever is on it
+    next |= lanes[STATE_AIR1] << (STATE_LANDING * TRACK_LANES);
+    next |= lanes[STATE_AIR2] << (STATE_AIR1 * TRACK_LANES);
+    next |= lanes[STATE_AIR3] << (STATE_AIR2 * TRACK_LANES);
+
+    // A free ship can jump this row and the next TRACK_JUMP_ROWS - 1
+    next |= lanes[STATE_FREE] << ((STATE_LANDING + TRACK_JUMP_ROWS - 1) * TRACK_LANES);
+
+    // Touching down needs a safe tile; jump pads launch straight away
+    uint32_t touchDown = lanes[STATE_FREE] | lanes[STATE_LANDING];
+    for (int lane = 0; lane < TRACK_LANES; lane++) {
+        if (!(touchDown & (1UL << lane)) || !isLandable(row.tiles[lane])) continue;
+        if (row.tiles[lane] == TILE_JUMP) {
+            next |= STATE_BIT(STATE_LANDING + TRACK_JUMP_ROWS, lane);
+        } else {
+            next |= STATE_BIT(STATE_FREE, lane);
+        }
+    }
+    return next;
+}
+
+void initTrackGenerator(TrackGenerator &gen, uint32_t seed, int startLane) {
+    gen.rng = seed ? seed : 1;   // xorshift is stuck at zero
+    gen.frontier = STATE_BIT(STATE_FREE, startLane);
+    gen.safeRows = TRACK_SAFE_START;
+    gen.head = 0;
+    gen.count = 0;
+}
+
+static void generateRow(TrackGenerator &gen, TrackRow &row) {
+    for (int lane = 0; lane < TRACK_LANES; lane++) {
+        int roll = gen.safeRows > 0 ? 0 : nextRandom(gen) % 100;
+
+        if (roll < 60) {
+            row.tiles[lane] = TILE_NORMAL;
+        } else if (roll < 70) {
+            row.tiles[lane] = TILE_SPEED;
+        } else if (roll < 80) {
+            row.tiles[lane] = TILE_JUMP;
+        } else if (roll < 88) {
+            row.tiles[lane] = TILE_DEADLY;
+        } else {
+            row.tiles[lane] = TILE_GAP;
+        }
+    }
+    if (gen.safeRows > 0) gen.safeRows--;
+
+    uint32_t next = advanceFrontier(gen.frontier, row);
+    if (next == 0) {
+        // Every ship would have to touch down here and none can. Pave one
+        // of the lanes they can reach, picked at random.
+        uint32_t touchDown = spreadLanes(
+            ((gen.frontier & STATE_MASK(STATE_FREE)) >> (STATE_FREE * TRACK_LANES)) |
+            ((gen.frontier & STATE_MASK(STATE_LANDING)) >> (STATE_LANDING * TRACK_LANES)));
+        int pick = nextRandom(gen) % __builtin_popcount(touchDown);
+        for (int lane = 0; lane < TRACK_LANES; lane++) {
+            if (!(touchDown & (1UL << lane))) continue;
+            if (pick-- == 0) {
+                row.tiles[lane] = TILE_NORMAL;
+                break;
+            }
+        }
+        next = advanceFrontier(gen.frontier, row);
+    }
+    gen.frontier = next;
+}
+
+void generateTrackChunk(TrackGenerator &gen) {
+    for (int n = 0; n < TRACK_CHUNK_ROWS && gen.count < TRACK_QUEUE_ROWS; n++) {
+        generateRow(gen, gen.queue[(gen.head + gen.count) % TRACK_QUEUE_ROWS]);
+        gen.count++;
+    }
+}
+
+void nextTrackRow(TrackGenerator &gen, TrackRow &row) {
+    if (gen.count == 0) {
+        generateRow(gen, row);
+        return;
+    }
+    row = gen.queue[gen.head];
+    gen.head = (gen.head + 1) % TRACK_QUEUE_ROWS;
+    gen.count--;
+}
+
+// Copy the next line into buf, false at the end of the level
+static bool readLevelLine(TrackLevel &level, char *buf) {
+    int len = 0;
+    if (level.file) {
+        int c = level.file.read();
+        if (c < 0) return false;
+        while (c >= 0 && c != '\n') {
+            if (len < LEVEL_LINE_LENGTH - 1) buf[len++] = c;
+            c = level.file.read();
+        }
+    } else {
+        if (!*level.text) return false;
+        while (*level.text && *level.text != '\n') {
+            if (len < LEVEL_LINE_LENGTH - 1) buf[len++] = *level.text;
+            level.text++;
+        }
+        if (*level.text == '\n') level.text++;
+    }
+    buf[len] = '\0';
+    return true;
+}
+
+static bool parseTile(char c, TileType &type) {
+    switch (c) {
+        case '.': type = TILE_NORMAL; return true;
+        case 's': type = TILE_SPEED; return true;
+        case 'j': type = TILE_JUMP; return true;
+        case 'x': type = TILE_DEADLY; return true;
+        case '_': type = TILE_GAP; return true;
+        default: return false;
+    }
+}
+
+// Parse "count tiles" into the current run; false for blank, comment
+// and malformed lines
+static bool parseLevelRun(TrackLevel &level, const char *line) {
+    char *end;
+    long count = strtol(line, &end, 10);
+    if (end == line || count <= 0) return false;
+
+    while (*end == ' ' || *end == '\t') end++;
+    TrackRow row;
+    for (int lane = 0; lane < TRACK_LANES; lane++) {
+        if (!parseTile(end[lane], row.tiles[lane])) return false;
+    }
+
+    level.row = row;
+    level.runLeft = count;
+    return true;
+}
+
+void openTrackLevel(TrackLevel &level) {
+    level.file = SD.open(LEVEL_PATH);
+    level.text = DEFAULT_LEVEL;
+    level.runLeft = 0;
+}
+
+bool nextLevelRow(TrackLevel &level, TrackRow &row) {
+    char line[LEVEL_LINE_LENGTH];
+    while (level.runLeft == 0) {
+        if (!readLevelLine(level, line)) return false;
+        parseLevelRun(level, line);
+    }
+    level.runLeft--;
+    row = level.row;
+    return true;
+}
+
+void closeTrackLevel(TrackLevel &level) {
+    if (level.file) level.file.close();
+}
@@ -0,0 +1,78 @@
+#ifndef GAME3_SKYROADS_TRACK_H
+#define GAME3_SKYROADS_TRACK_H
+
+#include <M5Stack.h>
+
+// Skyroads track sources. The seeded generator fills a queue of rows
+// ahead of the ship, carrying a reachability frontier from row to row so
+// every row handed out can be crossed by a ship playing at BASE_SPEED.
+// Authored levels are streamed from run-length encoded text, one run at
+// a time, so their length doesn't cost RAM.
+//
+// Level file format, one run of identical rows per line ('#' starts a comment):
+//   count tiles        tiles has one character per lane, left to right:
+//                      . normal  s speed  j jump pad  x deadly  _ gap
+// Runs are listed from the start of the level.
+
+#define TRACK_LANES 5
+#define TRACK_QUEUE_ROWS 64
+#define TRACK_CHUNK_ROWS 16     // Rows generated per idle-time top-up
+#define TRACK_SAFE_START 3      // All-normal rows at the start of a game
+#define LEVEL_PATH "/skyroads/level.txt"
+
+// Ship limits the generator plans for. At BASE_SPEED a row arrives every
+// TRACK_ROW_TICKS ticks, which is time to move one lane, and a jump flies
+// over TRACK_JUMP_ROWS rows before the ship must land.
+#define TRACK_ROW_TICKS 5
+#define TRACK_LANES_PER_ROW 1
+#define TRACK_JUMP_ROWS 3
+
+// Tile types
+enum TileType : uint8_t {
+    TILE_NORMAL = 0,
+    TILE_SPEED,
+    TILE_DEADLY,
+    TILE_JUMP,
+    TILE_GAP
+};
+
+struct TrackRow {
+    TileType tiles[TRACK_LANES];
+};
+
+struct TrackGenerator {
+    uint32_t rng;
+    uint32_t frontier;          // Reachable (state, lane) pairs after the newest row
+    int safeRows;               // All-normal rows still to generate
+    TrackRow queue[TRACK_QUEUE_ROWS];
+    int head;                   // Oldest queued row
+    int count;
+};
+
+struct TrackLevel {
+    File file;                  // Open while streaming from SD
+    const char *text;           // Built-in level when no file is open
+    TrackRow row;               // Row repeated by the current run
+    int runLeft;
+};
+
+void initTrackGenerator(TrackGenerator &gen, uint32_t seed, int startLane);
+
+// Frontier after crossing one more row
+uint32_t advanceFrontier(uint32_t frontier, const TrackRow &row);
+
+// Top up the queue by at most a chunk; call from idle frame time
+void generateTrackChunk(TrackGenerator &gen);
+
+// Hand out the next row, generating it on the spot if the queue ran dry
+void nextTrackRow(TrackGenerator &gen, TrackRow &row);
+
+// Open LEVEL_PATH from SD, falling back to the built-in level
+void openTrackLevel(TrackLevel &level);
+
+// Next row of the level; false once it has run out
+bool nextLevelRow(TrackLevel &level, TrackRow &row);
+
+void closeTrackLevel(TrackLevel &level);
+
+#endif
@@ -1,4 +1,9 @@
 #include "game4_tetris.h"
+#include "game4_tetris_search.h"
+#include "../engine/input_events.h"
+#include "../engine/title_screen.h"
+#include "../engine/arena.h"
+#include "../engine/lcd_batch.h"
 #include <Wire.h>
 
 // Game constants
@@ -13,6 +18,23 @@
 // Faces GameBoy I2C address
 #define FACES_ADDR 0x08
 
+// Button bindings, as Faces button bits
+#define BTN_HOLD 0x01          // Up
+#define BTN_HARD_DROP 0x02     // Down
+#define BTN_LEFT 0x04
+#define BTN_RIGHT 0x08
+#define BTN_ROTATE 0x10        // A
+#define BTN_SOFT_DROP 0x20     // B
+#define BTN_AUTOPLAY 0x80      // Start
+
+// Input timing
+#define DAS_MS 170             // Hold time before auto-shift starts
+#define ARR_MS 50              // Auto-shift repeat, AUTO_SHIFT_INSTANT for 0-ARR
+#define SOFT_DROP_MS 50        // Gravity while soft drop is held
+#define INPUT_POLL_MS 4        // Input is sampled this often between frames
+#define BOT_MOVE_MS 150        // Autoplay places a piece this often
+#define TITLE_MS 2000
+
 // Tetromino shapes (7 pieces, 4 rotations each)
 // Each shape is 4x4 grid
 const bool SHAPES[7][4][4][4] = {
@@ -78,8 +100,15 @@ const uint16_t PIECE_COLORS[7] = {
     TFT_ORANGE    // L
 };
 
+// Lowest filled row of each shape column, -1 for empty columns
+static int8_t pieceBottom[7][4][4];
+
 // Game state
-static uint8_t board[BOARD_HEIGHT][BOARD_WIDTH];
+static uint8_t (*board)[BOARD_WIDTH];      // BOARD_HEIGHT rows, in the arena
+static uint32_t columnBits[BOARD_WIDTH];   // Bit y set when board[y][x] is filled
+static uint8_t columnHeight[BOARD_WIDTH];  // Filled height from the floor to the top block
+static uint8_t rowCount[BOARD_HEIGHT];     // Filled cells per row
+static int ghostY = -1;                    // Row the ghost is drawn at, -1 for none
 static int currentPiece;
 static int currentRotation;
 static int currentX;
@@ -95,8 +124,15 @@ static int level;
 static bool gameOver;
 static uint8_t facesData = 0xFF;
 static bool needsFullRedraw = true;
-static unsigned long lastDownPress = 0;
-static int downPressCount = 0;
+static InputQueue inputQueue;
+static AutoShift autoShift;
+static bool softDropHeld = false;
+static bool autoplay = false;
+static unsigned long lastBotMove;
+static SearchContext *searchContext;
+static TitleScreen title;
+static bool inTitle = false;
+static int warmStep;            // Next table to build behind the title
 
 static void readFacesButtons() {
     Wire.requestFrom(FACES_ADDR, 1);
@@ -128,6 +164,42 @@ void drawBoard() {
     }
 }
 
+// Outline where the current piece would land
+void drawGhostPiece(int y) {
+    for (int py = 0; py < 4; py++) {
+        for (int px = 0; px < 4; px++) {
+            if (SHAPES[currentPiece][currentRotation][py][px]) {
+                int boardX = currentX + px;
+                int boardY = y + py;
+                if (boardY >= 0 && boardY < BOARD_HEIGHT) {
+                    M5.Lcd.drawRect(BOARD_X + boardX * BLOCK_SIZE, BOARD_Y + boardY * BLOCK_SIZE,
+                                    BLOCK_SIZE - 1, BLOCK_SIZE - 1, PIECE_COLORS[currentPiece]);
+                }
+            }
+        }
+    }
+}
+
+// Redraw the board under a piece's cells
+void restorePieceCells(int piece, int rotation, int x, int y) {
+    for (int py = 0; py < 4; py++) {
+        for (int px = 0; px < 4; px++) {
+            if (SHAPES[piece][rotation][py][px]) {
+                int boardX = x + px;
+                int boardY = y + py;
+                if (boardY >= 0 && boardY < BOARD_HEIGHT &&
+                    boardX >= 0 && boardX < BOARD_WIDTH) {
+                    if (board[boardY][boardX] > 0) {
+                        drawBlock(boardX, boardY, PIECE_COLORS[board[boardY][boardX] - 1]);
+                    } else {
+                        drawBlock(boardX, boardY, TFT_BLACK);
+                    }
+                }
+            }
+        }
+    }
+}
+
 void drawCurrentPiece(uint16_t color) {
     for (int y = 0; y < 4; y++) {
         for (int x = 0; x < 4; x++) {
@@ -202,19 +274,22 @@ void drawUI() {
     M5.Lcd.fillRect(10, 205, 80, 10, TFT_BLACK);
     M5.Lcd.print(level);
 
+    M5.Lcd.setCursor(10, 225);
+    M5.Lcd.print("START:Autoplay");
+
     M5.Lcd.setCursor(230, 20);
     M5.Lcd.print("CONTROLS:");
     M5.Lcd.setTextSize(1);
     M5.Lcd.setCursor(230, 40);
     M5.Lcd.print("L/R:Move");
     M5.Lcd.setCursor(230, 55);
-    M5.Lcd.print("DOWN:Drop");
+    M5.Lcd.print("DOWN:Hard drop");
     M5.Lcd.setCursor(230, 70);
     M5.Lcd.print("UP:Hold");
     M5.Lcd.setCursor(230, 85);
     M5.Lcd.print("A:Rotate");
     M5.Lcd.setCursor(230, 100);
-    M5.Lcd.print("B:Fast");
+    M5.Lcd.print("B:Soft drop");
 
     M5.Lcd.setCursor(250, 155);
     M5.Lcd.print("HOLD:");
@@ -243,6 +318,41 @@ bool checkCollision(int piece, int rotation, int x, int y) {
     return false;
 }
 
+static void buildPieceProfiles() {
+    for (int piece = 0; piece < 7; piece++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            for (int x = 0; x < 4; x++) {
+                pieceBottom[piece][rotation][x] = -1;
+                for (int y = 0; y < 4; y++) {
+                    if (SHAPES[piece][rotation][y][x]) pieceBottom[piece][rotation][x] = y;
+                }
+            }
+        }
+    }
+}
+
+static void updateColumnHeight(int x) {
+    columnHeight[x] = columnBits[x] ? BOARD_HEIGHT - __builtin_ctz(columnBits[x]) : 0;
+}
+
+// Rows the piece can fall from (x, y) before it lands. Each shape column
+// looks for the first filled cell below its lowest block, so overhangs
+// are handled and no cell-by-cell collision test is needed.
+int dropDistance(int piece, int rotation, int x, int y) {
+    int distance = BOARD_HEIGHT;
+    for (int px = 0; px < 4; px++) {
+        int bottom = pieceBottom[piece][rotation][px];
+        if (bottom < 0) continue;
+
+        int row = y + bottom;
+        uint32_t below = columnBits[x + px];
+        if (row >= 0) below &= ~((2UL << row) - 1);
+        int fall = below ? __builtin_ctz(below) - row - 1 : BOARD_HEIGHT - 1 - row;
+        distance = min(distance, fall);
+    }
+    return distance;
+}
+
 void placePiece() {
     for (int y = 0; y < 4; y++) {
         for (int x = 0; x < 4; x++) {
@@ -252,25 +362,24 @@ void placePiece() {
                 if (boardY >= 0 && boardY < BOARD_HEIGHT &&
                     boardX >= 0 && boardX < BOARD_WIDTH) {
                     board[boardY][boardX] = currentPiece + 1;
+                    columnBits[boardX] |= 1UL << boardY;
+                    rowCount[boardY]++;
                 }
             }
         }
     }
+    for (int x = 0; x < 4; x++) {
+        if (currentX + x >= 0 && currentX + x < BOARD_WIDTH) {
+            updateColumnHeight(currentX + x);
+        }
+    }
 }
 
 int clearLines() {
     int cleared = 0;
 
     for (int y = BOARD_HEIGHT - 1; y >= 0; y--) {
-        bool lineFull = true;
-        for (int x = 0; x < BOARD_WIDTH; x++) {
-            if (board[y][x] == 0) {
-                lineFull = false;
-                break;
-            }
-        }
-
-        if (lineFull) {
+        if (rowCount[y] == BOARD_WIDTH) {
             cleared++;
             // Flash line before clearing
             for (int x = 0; x < BOARD_WIDTH; x++) {
@@ -288,6 +397,19 @@ int clearLines() {
             for (int x = 0; x < BOARD_WIDTH; x++) {
                 board[0][x] = 0;
             }
+
+            // Rows above y move down one: their bits move up one
+            uint32_t above = (1UL << y) - 1;
+            for (int x = 0; x < BOARD_WIDTH; x++) {
+                columnBits[x] = (columnBits[x] & ~(above | (1UL << y))) |
+                                ((columnBits[x] & above) << 1);
+                updateColumnHeight(x);
+            }
+            for (int yy = y; yy > 0; yy--) {
+                rowCount[yy] = rowCount[yy - 1];
+            }
+            rowCount[0] = 0;
+
             y++; // Recheck this line
         }
     }
@@ -334,13 +456,174 @@ void holdPiece() {
     drawHeldPiece();
 }
 
-static void resetGame() {
+// Sample the buttons into the timestamped queue
+static void pollInput() {
+    readFacesButtons();
+    pushInputState(inputQueue, ~facesData, millis());
+}
+
+static void tryShift(int dir) {
+    if (!checkCollision(currentPiece, currentRotation, currentX + dir, currentY)) {
+        currentX += dir;
+    }
+}
+
+static void slideToWall(int dir) {
+    while (!checkCollision(currentPiece, currentRotation, currentX + dir, currentY)) {
+        currentX += dir;
+    }
+}
+
+// With 0-ARR a charged shift keeps the piece against the wall through
+// rotations and new pieces
+static void hugWall() {
+    if (autoShiftInstant(autoShift)) {
+        slideToWall(autoShift.dir);
+    }
+}
+
+// time is when the event that locked it happened, so gravity for the new
+// piece runs from there rather than from whenever the frame got to it
+static void lockPiece(uint32_t time) {
+    placePiece();
+
+    // Draw the placed piece immediately
+    drawBoard();
+
+    // Clear lines
+    int cleared = clearLines();
+    if (cleared > 0) {
+        linesCleared += cleared;
+        // Scoring: 100, 300, 500, 800 for 1, 2, 3, 4 lines
+        int points[] = {0, 100, 300, 500, 800};
+        score += points[cleared] * level;
+
+        // Level up every 10 lines
+        level = linesCleared / 10 + 1;
+        moveDelay = max(100, 500 - (level - 1) * 40);
+
+        drawBoard();
+        drawUI();
+    }
+
+    // Spawn new piece
+    spawnNewPiece();
+    drawNextPiece();
+    lastMoveTime = time;
+}
+
+static void hardDrop(uint32_t time) {
+    int distance = dropDistance(currentPiece, currentRotation, currentX, currentY);
+    currentY += distance;
+    score += 2 * distance;  // More points for hard drop
+    lockPiece(time);
+}
+
+// Let the search place the current piece, holding first if it says so
+static void playBotMove(uint32_t time) {
+    SearchBoard searchBoard;
+    loadSearchBoard(searchBoard, board);
+
+    SearchMove move;
+    if (!findBestMove(*searchContext, searchBoard, currentPiece, nextPiece,
+                      heldPiece, canHold, move)) {
+        return;  // Nowhere to go; gravity tops the piece out
+    }
+
+    if (move.hold) {
+        holdPiece();
+        needsFullRedraw = true;
+        if (gameOver) return;
+    }
+    currentRotation = move.placement.rotation;
+    currentX = move.placement.x;
+    currentY = move.placement.y;
+    lockPiece(time);
+}
+
+static unsigned long gravityDelay() {
+    return softDropHeld ? SOFT_DROP_MS : moveDelay;
+}
+
+// Run auto-shift repeats and gravity due up to the given time, earliest
+// first, so they interleave with input exactly as they fell due
+static void runTimersUntil(uint32_t until) {
+    while (!gameOver) {
+        uint32_t gravityTime = lastMoveTime + gravityDelay();
+        bool gravityDue = (int32_t)(gravityTime - until) <= 0;
+        uint32_t shiftTime;
+        bool shiftDue = autoShiftDue(autoShift, until, shiftTime);
+
+        if (shiftDue && (!gravityDue || (int32_t)(shiftTime - gravityTime) <= 0)) {
+            int8_t dir = autoShiftFire(autoShift);
+            if (autoShift.arr == AUTO_SHIFT_INSTANT) {
+                slideToWall(dir);
+            } else {
+                tryShift(dir);
+            }
+        } else if (gravityDue) {
+            lastMoveTime = gravityTime;
+            if (dropDistance(currentPiece, currentRotation, currentX, currentY) > 0) {
+                currentY++;
+            } else {
+                lockPiece(gravityTime);
+            }
+        } else {
+            break;
+        }
+        hugWall();
+    }
+}
+
+static void applyInputEvent(const InputEvent &event) {
+    uint8_t pressed = event.changed & event.pressed;
+    uint8_t released = event.changed & ~event.pressed;
+
+    if (pressed & BTN_LEFT) tryShift(autoShiftPress(autoShift, -1, event.time));
+    if (pressed & BTN_RIGHT) tryShift(autoShiftPress(autoShift, 1, event.time));
+    if (released & BTN_LEFT) autoShiftRelease(autoShift, -1, event.time);
+    if (released & BTN_RIGHT) autoShiftRelease(autoShift, 1, event.time);
+    softDropHeld = event.pressed & BTN_SOFT_DROP;
+
+    // Hold piece with UP button
+    if (pressed & BTN_HOLD) {
+        holdPiece();
+        needsFullRedraw = true;  // Force redraw to show held piece
+    }
+
+    // Rotate
+    if (pressed & BTN_ROTATE) {
+        int newRotation = (currentRotation + 1) % 4;
+        if (!checkCollision(currentPiece, newRotation, currentX, currentY)) {
+            currentRotation = newRotation;
+        }
+    }
+
+    if (pressed & BTN_AUTOPLAY) {
+        autoplay = !autoplay;
+        lastBotMove = event.time;
+    }
+
+    if ((pressed & BTN_HARD_DROP) && !gameOver) {
+        hardDrop(event.time);
+    }
+    hugWall();
+}
+
+// time is when the press that started the game was read
+static void resetGame(uint32_t time) {
     // Clear board
     for (int y = 0; y < BOARD_HEIGHT; y++) {
         for (int x = 0; x < BOARD_WIDTH; x++) {
             board[y][x] = 0;
         }
+        rowCount[y] = 0;
+    }
+    for (int x = 0; x < BOARD_WIDTH; x++) {
+        columnBits[x] = 0;
+        columnHeight[x] = 0;
     }
+    ghostY = -1;
 
     score = 0;
     linesCleared = 0;
@@ -350,15 +633,19 @@ static void resetGame() {
     needsFullRedraw = true;
     heldPiece = -1;
     canHold = true;
-    downPressCount = 0;
-    lastDownPress = 0;
+
+    // Buttons still down from the last screen don't count as presses
+    readFacesButtons();
+    initInputQueue(inputQueue, ~facesData);
+    initAutoShift(autoShift, DAS_MS, ARR_MS);
+    softDropHeld = false;
 
     currentPiece = random(7);
     nextPiece = random(7);
     currentRotation = 0;
     currentX = BOARD_WIDTH / 2 - 2;
     currentY = 0;
-    lastMoveTime = millis();
+    lastMoveTime = time;
 }
 
 void game4Setup() {
@@ -370,13 +657,43 @@ void game4Setup() {
     M5.Lcd.setTextSize(1);
     M5.Lcd.setCursor(60, 140);
     M5.Lcd.println("Get ready...");
-    delay(2000);
 
-    randomSeed(analogRead(0));
-    resetGame();
+    board = arenaArray<uint8_t[BOARD_WIDTH]>(BOARD_HEIGHT);
+    searchContext = arenaArray<SearchContext>(1);
+    warmStep = 0;
+    readFacesButtons();
+    startTitle(title, TITLE_MS, ~facesData);
+    inTitle = true;
+}
+
+// Build one of the lookup tables, true once they are all ready
+static bool warmUpTables() {
+    switch (warmStep) {
+        case 0: buildPieceProfiles(); break;
+        case 1: initSearchTables(); break;
+        case 2: initSearchContext(*searchContext, DEFAULT_WEIGHTS); break;
+        default: return true;
+    }
+    warmStep++;
+    return false;
+}
+
+void game4Teardown() {
+    autoplay = false;
 }
 
 void game4Loop() {
+    if (inTitle) {
+        bool warmed = warmUpTables();
+        readFacesButtons();
+        uint32_t pressTime = millis();
+        if (!updateTitle(title, ~facesData, warmed)) return;
+        inTitle = false;
+
+        randomSeed(analogRead(0));
+        resetGame(pressTime);
+    }
+
     if (gameOver) {
         M5.Lcd.fillRect(BOARD_X + 10, BOARD_Y + 80, 80, 60, TFT_RED);
         M5.Lcd.setTextColor(TFT_WHITE);
@@ -391,11 +708,12 @@ void game4Loop() {
 
         M5.update();
         readFacesButtons();
+        uint32_t pressTime = millis();
         bool facesA = !(facesData & 0x10);
 
         static bool lastA = false;
         if (facesA && !lastA) {
-            resetGame();
+            resetGame(pressTime);
         }
         lastA = facesA;
         delay(50);
@@ -412,142 +730,38 @@ void game4Loop() {
     }
 
     M5.update();
-    readFacesButtons();
-
-    bool facesLeft = !(facesData & 0x04);
-    bool facesRight = !(facesData & 0x08);
-    bool facesDown = !(facesData & 0x02);
-    bool facesUp = !(facesData & 0x01);
-    bool facesA = !(facesData & 0x10);
-    bool facesB = !(facesData & 0x20);
-
-    static bool lastLeft = false;
-    static bool lastRight = false;
-    static bool lastDown = false;
-    static bool lastUp = false;
-    static bool lastA = false;
-    static bool lastB = false;
-
-    // Erase current piece (draw over it with board state)
-    for (int y = 0; y < 4; y++) {
-        for (int x = 0; x < 4; x++) {
-            if (SHAPES[currentPiece][currentRotation][y][x]) {
-                int boardX = currentX + x;
-                int boardY = currentY + y;
-                if (boardY >= 0 && boardY < BOARD_HEIGHT &&
-                    boardX >= 0 && boardX < BOARD_WIDTH) {
-                    // Redraw the board cell at this position
-                    if (board[boardY][boardX] > 0) {
-                        drawBlock(boardX, boardY, PIECE_COLORS[board[boardY][boardX] - 1]);
-                    } else {
-                        drawBlock(boardX, boardY, TFT_BLACK);
-                    }
-                }
-            }
-        }
-    }
-
-    // Move left
-    if (facesLeft && !lastLeft) {
-        if (!checkCollision(currentPiece, currentRotation, currentX - 1, currentY)) {
-            currentX--;
-        }
-    }
-
-    // Move right
-    if (facesRight && !lastRight) {
-        if (!checkCollision(currentPiece, currentRotation, currentX + 1, currentY)) {
-            currentX++;
-        }
-    }
-
-    // Hold piece with UP button
-    if (facesUp && !lastUp) {
-        holdPiece();
-        needsFullRedraw = true;  // Force redraw to show held piece
-    }
+    pollInput();
+    uint32_t frameStart = millis();
 
-    // Rotate
-    if (facesA && !lastA) {
-        int newRotation = (currentRotation + 1) % 4;
-        if (!checkCollision(currentPiece, newRotation, currentX, currentY)) {
-            currentRotation = newRotation;
-        }
+    // Erase ghost and current piece (draw over them with board state)
+    beginLcdFrame();
+    if (ghostY >= 0) {
+        restorePieceCells(currentPiece, currentRotation, currentX, ghostY);
     }
+    restorePieceCells(currentPiece, currentRotation, currentX, currentY);
 
-    // Fast drop with B button
-    unsigned long currentDelay = (facesB) ? 50 : moveDelay;
-
-    // Manual drop and triple-down detection
-    if (facesDown && !lastDown) {
-        unsigned long currentTime = millis();
-
-        // Check for triple down press (3 presses within 500ms)
-        if (currentTime - lastDownPress < 500) {
-            downPressCount++;
-            if (downPressCount >= 2) {  // Third press (0, 1, 2)
-                // Hard drop - drop piece all the way down
-                while (!checkCollision(currentPiece, currentRotation, currentX, currentY + 1)) {
-                    currentY++;
-                    score += 2;  // More points for hard drop
-                }
-                downPressCount = 0;
-            }
-        } else {
-            downPressCount = 0;
-        }
-        lastDownPress = currentTime;
-
-        // Regular manual drop
-        if (downPressCount < 2 && !checkCollision(currentPiece, currentRotation, currentX, currentY + 1)) {
-            currentY++;
-            score += 1;
-        }
+    // Replay input in the order it happened, with timers in between
+    InputEvent event;
+    while (!gameOver && popInputEvent(inputQueue, event)) {
+        runTimersUntil(event.time);
+        if (!gameOver) applyInputEvent(event);
     }
+    runTimersUntil(frameStart);
 
-    // Auto drop
-    if (millis() - lastMoveTime > currentDelay) {
-        if (!checkCollision(currentPiece, currentRotation, currentX, currentY + 1)) {
-            currentY++;
-        } else {
-            // Place piece
-            placePiece();
-
-            // Draw the placed piece immediately
-            drawBoard();
-
-            // Clear lines
-            int cleared = clearLines();
-            if (cleared > 0) {
-                linesCleared += cleared;
-                // Scoring: 100, 300, 500, 800 for 1, 2, 3, 4 lines
-                int points[] = {0, 100, 300, 500, 800};
-                score += points[cleared] * level;
-
-                // Level up every 10 lines
-                level = linesCleared / 10 + 1;
-                moveDelay = max(100, 500 - (level - 1) * 40);
-
-                drawBoard();
-                drawUI();
-            }
-
-            // Spawn new piece
-            spawnNewPiece();
-            drawNextPiece();
-        }
-        lastMoveTime = millis();
+    if (autoplay && !gameOver && frameStart - lastBotMove >= BOT_MOVE_MS) {
+        playBotMove(frameStart);
+        lastBotMove = frameStart;
     }
 
-    // Draw current piece
+    // Draw ghost, then current piece over it
+    ghostY = currentY + dropDistance(currentPiece, currentRotation, currentX, currentY);
+    drawGhostPiece(ghostY);
     drawCurrentPiece(PIECE_COLORS[currentPiece]);
+    endLcdFrame();
 
-    lastLeft = facesLeft;
-    lastRight = facesRight;
-    lastDown = facesDown;
-    lastUp = facesUp;
-    lastA = facesA;
-    lastB = facesB;
-
-    delay(20);
+    // Keep sampling until the next frame so presses get accurate times
+    while (millis() - frameStart < GAME4_FRAME_MS) {
+        delay(INPUT_POLL_MS);
+        pollInput();
+    }
 }
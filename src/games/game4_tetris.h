@@ -3,7 +3,10 @@
 
 #include <M5Stack.h>
 
+#define GAME4_FRAME_MS 20     // What the loop paces itself to
+
 void game4Setup();
 void game4Loop();
+void game4Teardown();
 
 #endif
@@ -0,0 +1,312 @@
+#include "game4_tetris_search.h"
+
+#define STATE_INDEX(x, y, rotation) \
+    (((rotation) * SEARCH_HEIGHT + (y)) * SEARCH_SPAN_X + (x) - SEARCH_MIN_X)
+
+// The usual linear weights for these four features, scaled to integers
+const SearchWeights DEFAULT_WEIGHTS = {
+    51,     // height
+    36,     // holes
+    18,     // bumpiness
+    76      // lines
+};
+
+static uint8_t pieceRows[7][4][4];     // Shape row masks, bit px for shape column px
+static int8_t pieceLeft[7][4];         // First and last filled shape columns
+static int8_t pieceRight[7][4];
+static uint64_t cellKeys[SEARCH_HEIGHT][SEARCH_WIDTH];
+static uint64_t pieceKeys[7];
+
+static uint64_t nextKey(uint64_t &state) {
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+void initSearchTables() {
+    for (int piece = 0; piece < 7; piece++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            pieceLeft[piece][rotation] = 3;
+            pieceRight[piece][rotation] = 0;
+            for (int py = 0; py < 4; py++) {
+                uint8_t mask = 0;
+                for (int px = 0; px < 4; px++) {
+                    if (!SHAPES[piece][rotation][py][px]) continue;
+                    mask |= 1 << px;
+                    pieceLeft[piece][rotation] = min(pieceLeft[piece][rotation], (int8_t)px);
+                    pieceRight[piece][rotation] = max(pieceRight[piece][rotation], (int8_t)px);
+                }
+                pieceRows[piece][rotation][py] = mask;
+            }
+        }
+    }
+
+    // Fixed seed, so hashes are the same from run to run
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int y = 0; y < SEARCH_HEIGHT; y++) {
+        for (int x = 0; x < SEARCH_WIDTH; x++) {
+            cellKeys[y][x] = nextKey(state);
+        }
+    }
+    for (int piece = 0; piece < 7; piece++) {
+        pieceKeys[piece] = nextKey(state);
+    }
+}
+
+void initSearchContext(SearchContext &ctx, const SearchWeights &weights) {
+    ctx.weights = weights;
+    for (int i = 0; i < TT_SIZE; i++) {
+        ctx.table[i].key = 0;
+        ctx.table[i].score = 0;
+    }
+    ctx.nodes = 0;
+    ctx.hits = 0;
+}
+
+// Shape row mask moved to board column x
+static inline uint16_t rowMask(uint8_t mask, int x) {
+    return x >= 0 ? mask << x : mask >> -x;
+}
+
+static uint64_t hashRow(int y, uint16_t mask) {
+    uint64_t hash = 0;
+    while (mask) {
+        hash ^= cellKeys[y][__builtin_ctz(mask)];
+        mask &= mask - 1;
+    }
+    return hash;
+}
+
+static uint64_t hashBoard(const SearchBoard &board) {
+    uint64_t hash = 0;
+    for (int y = 0; y < SEARCH_HEIGHT; y++) {
+        hash ^= hashRow(y, board.rows[y]);
+    }
+    return hash;
+}
+
+void loadSearchBoard(SearchBoard &board, const uint8_t cells[][SEARCH_WIDTH]) {
+    for (int y = 0; y < SEARCH_HEIGHT; y++) {
+        uint16_t row = 0;
+        for (int x = 0; x < SEARCH_WIDTH; x++) {
+            if (cells[y][x]) row |= 1 << x;
+        }
+        board.rows[y] = row;
+    }
+    board.hash = hashBoard(board);
+}
+
+// Same rules as the game: walls and floor are solid, above the top is open
+static bool collides(const SearchBoard &board, int piece, int rotation, int x, int y) {
+    if (x + pieceLeft[piece][rotation] < 0 ||
+        x + pieceRight[piece][rotation] >= SEARCH_WIDTH) {
+        return true;
+    }
+    for (int py = 0; py < 4; py++) {
+        uint8_t mask = pieceRows[piece][rotation][py];
+        if (!mask) continue;
+        int row = y + py;
+        if (row >= SEARCH_HEIGHT) return true;
+        if (row >= 0 && (board.rows[row] & rowMask(mask, x))) return true;
+    }
+    return false;
+}
+
+// Hash of the cells a resting piece covers, to spot rotations and
+// positions that fill the same cells
+static uint64_t footprintHash(int piece, int rotation, int x, int y) {
+    uint64_t hash = 0;
+    for (int py = 0; py < 4; py++) {
+        uint8_t mask = pieceRows[piece][rotation][py];
+        if (mask) hash ^= hashRow(y + py, rowMask(mask, x));
+    }
+    return hash;
+}
+
+int generatePlacements(SearchContext &ctx, const SearchBoard &board, int piece,
+                       Placement *out) {
+    if (collides(board, piece, 0, SEARCH_SPAWN_X, 0)) return 0;
+
+    // Shift left, shift right, rotate; soft drop is tried separately
+    static const int8_t MOVES[3][2] = {{-1, 0}, {1, 0}, {0, 1}};   // dx, rotation
+
+    uint32_t *visited = ctx.walk.visited;
+    uint16_t *queue = ctx.walk.queue;
+    uint64_t *footprints = ctx.walk.footprints;
+    memset(visited, 0, sizeof(ctx.walk.visited));
+    int head = 0;
+    int tail = 0;
+    int count = 0;
+
+    int start = STATE_INDEX(SEARCH_SPAWN_X, 0, 0);
+    visited[start / 32] |= 1UL << (start % 32);
+    queue[tail++] = start;
+
+    while (head < tail) {
+        int state = queue[head++];
+        int x = state % SEARCH_SPAN_X + SEARCH_MIN_X;
+        int y = (state / SEARCH_SPAN_X) % SEARCH_HEIGHT;
+        int rotation = state / (SEARCH_SPAN_X * SEARCH_HEIGHT);
+
+        bool resting = collides(board, piece, rotation, x, y + 1);
+        for (int m = 0; m <= 3; m++) {
+            int nx = x, ny = y, nr = rotation;
+            if (m < 3) {
+                nx += MOVES[m][0];
+                nr = (rotation + MOVES[m][1]) % 4;
+                if (collides(board, piece, nr, nx, ny)) continue;
+            } else {
+                if (resting) continue;
+                ny++;
+            }
+
+            int next = STATE_INDEX(nx, ny, nr);
+            if (visited[next / 32] & (1UL << (next % 32))) continue;
+            visited[next / 32] |= 1UL << (next % 32);
+            queue[tail++] = next;
+        }
+
+        if (!resting || count == MAX_PLACEMENTS) continue;
+
+        uint64_t footprint = footprintHash(piece, rotation, x, y);
+        bool seen = false;
+        for (int i = 0; i < count && !seen; i++) {
+            seen = footprints[i] == footprint;
+        }
+        if (seen) continue;
+
+        footprints[count] = footprint;
+        out[count].x = x;
+        out[count].y = y;
+        out[count].rotation = rotation;
+        count++;
+    }
+    return count;
+}
+
+int applyPlacement(SearchBoard &board, int piece, const Placement &placement) {
+    int lines = 0;
+    for (int py = 0; py < 4; py++) {
+        uint8_t mask = pieceRows[piece][placement.rotation][py];
+        if (!mask) continue;
+        int row = placement.y + py;
+        uint16_t cells = rowMask(mask, placement.x);
+        board.rows[row] |= cells;
+        board.hash ^= hashRow(row, cells);
+        if (board.rows[row] == SEARCH_FULL_ROW) lines++;
+    }
+    if (lines == 0) return 0;
+
+    // Drop the rows above each full one; every cell moves, so rehash
+    int write = SEARCH_HEIGHT - 1;
+    for (int read = SEARCH_HEIGHT - 1; read >= 0; read--) {
+        if (board.rows[read] != SEARCH_FULL_ROW) board.rows[write--] = board.rows[read];
+    }
+    while (write >= 0) board.rows[write--] = 0;
+    board.hash = hashBoard(board);
+    return lines;
+}
+
+int32_t evaluateBoard(const SearchWeights &weights, const SearchBoard &board) {
+    uint8_t heights[SEARCH_WIDTH] = {0};
+    uint16_t covered = 0;   // Columns with a block in this row or above
+    int holes = 0;
+
+    for (int y = 0; y < SEARCH_HEIGHT; y++) {
+        uint16_t row = board.rows[y];
+        holes += __builtin_popcount(covered & ~row);
+        uint16_t tops = row & ~covered;
+        while (tops) {
+            heights[__builtin_ctz(tops)] = SEARCH_HEIGHT - y;
+            tops &= tops - 1;
+        }
+        covered |= row;
+    }
+
+    int height = heights[0];
+    int bumpiness = 0;
+    for (int x = 1; x < SEARCH_WIDTH; x++) {
+        height += heights[x];
+        bumpiness += abs(heights[x] - heights[x - 1]);
+    }
+
+    return -((int32_t)weights.height * height +
+             (int32_t)weights.holes * holes +
+             (int32_t)weights.bumpiness * bumpiness);
+}
+
+// Best score over every placement of one piece. The same board often
+// comes up from different first moves, so results are kept in the table.
+static int32_t bestPlacementScore(SearchContext &ctx, const SearchBoard &board, int piece) {
+    uint64_t key = board.hash ^ pieceKeys[piece];
+    TTEntry &entry = ctx.table[key & (TT_SIZE - 1)];
+    if (entry.key == key) {
+        ctx.hits++;
+        return entry.score;
+    }
+
+    Placement *placements = ctx.placements[1];
+    int count = generatePlacements(ctx, board, piece, placements);
+    int32_t best = SEARCH_LOST;
+    for (int i = 0; i < count; i++) {
+        SearchBoard after = board;
+        int lines = applyPlacement(after, piece, placements[i]);
+        int32_t score = evaluateBoard(ctx.weights, after) + ctx.weights.lines * lines;
+        best = max(best, score);
+        ctx.nodes++;
+    }
+
+    entry.key = key;
+    entry.score = best;
+    return best;
+}
+
+// Try every placement of piece, scoring each by the best follow-up with
+// whichever of the two pieces could be played next (-1 for none)
+static bool searchPiece(SearchContext &ctx, const SearchBoard &board, int piece,
+                        int follow1, int follow2, bool hold, SearchMove &move) {
+    Placement *placements = ctx.placements[0];
+    int count = generatePlacements(ctx, board, piece, placements);
+
+    for (int i = 0; i < count; i++) {
+        SearchBoard after = board;
+        int lines = applyPlacement(after, piece, placements[i]);
+
+        int32_t score = SEARCH_LOST;
+        if (follow1 >= 0) score = max(score, bestPlacementScore(ctx, after, follow1));
+        if (follow2 >= 0 && follow2 != follow1) {
+            score = max(score, bestPlacementScore(ctx, after, follow2));
+        }
+        score += ctx.weights.lines * lines;
+
+        if (score > move.score) {
+            move.hold = hold;
+            move.placement = placements[i];
+            move.score = score;
+        }
+    }
+    return count > 0;
+}
+
+bool findBestMove(SearchContext &ctx, const SearchBoard &board, int current,
+                  int next, int held, bool canHold, SearchMove &move) {
+    ctx.nodes = 0;
+    ctx.hits = 0;
+    move.score = INT32_MIN;
+
+    // Hold is free again once a piece locks, so the second ply may take
+    // either the next piece or whatever is in hold
+    bool found = searchPiece(ctx, board, current, next, held, false, move);
+    if (canHold) {
+        if (held >= 0) {
+            found |= searchPiece(ctx, board, held, next, current, true, move);
+        } else {
+            // Holding into an empty slot plays the next piece now; the
+            // one after it isn't known yet
+            found |= searchPiece(ctx, board, next, current, -1, true, move);
+        }
+    }
+    return found;
+}
@@ -0,0 +1,111 @@
+#ifndef GAME4_TETRIS_SEARCH_H
+#define GAME4_TETRIS_SEARCH_H
+
+#include <M5Stack.h>
+
+// Placement search for the Tetris autoplayer. Boards are rows of column
+// bits, so a piece row is tested against a board row with one AND.
+// Placements are found by a breadth-first walk over (x, y, rotation) from
+// the spawn using the player's own moves (shift, rotate, soft drop), which
+// finds tucks under overhangs and rotations into slots as well as plain
+// drops. Boards carry a Zobrist hash: placements that fill the same cells
+// are generated once, and scored boards are cached in a fixed-size
+// transposition table.
+//
+// Search state lives in a SearchContext rather than in statics, so
+// separate contexts can search side by side, e.g. one per weight set. The
+// walk's queue and the placement lists live there too: the game task's
+// stack is 8 KB and they come to nearly 4 KB.
+
+#define SEARCH_WIDTH 10
+#define SEARCH_HEIGHT 20
+#define SEARCH_FULL_ROW ((1U << SEARCH_WIDTH) - 1)
+#define SEARCH_SPAWN_X (SEARCH_WIDTH / 2 - 2)
+#define SEARCH_LOST (-1000000000L)  // Score of a board the next piece can't enter
+#define MAX_PLACEMENTS 128
+#define TT_BITS 10
+#define TT_SIZE (1 << TT_BITS)
+
+// Walk states cover every x a piece can stand at: shape columns 0-3, and
+// no shape has its first filled column further right than 2
+#define SEARCH_MIN_X (-2)
+#define SEARCH_SPAN_X (SEARCH_WIDTH - SEARCH_MIN_X)
+#define SEARCH_STATES (4 * SEARCH_HEIGHT * SEARCH_SPAN_X)
+
+// Defined with the piece colors in game4_tetris.cpp
+extern const bool SHAPES[7][4][4][4];
+
+struct SearchBoard {
+    uint16_t rows[SEARCH_HEIGHT];   // Bit x set when column x is filled, row 0 at the top
+    uint64_t hash;                  // XOR of the filled cells' keys
+};
+
+// Final resting state of a piece, in game coordinates
+struct Placement {
+    int8_t x;
+    int8_t y;
+    int8_t rotation;
+};
+
+// Penalties per unit, and the reward per cleared line
+struct SearchWeights {
+    int16_t height;        // Sum of column heights
+    int16_t holes;         // Empty cells with a block somewhere above
+    int16_t bumpiness;     // Height steps between neighbouring columns
+    int16_t lines;
+};
+
+struct TTEntry {
+    uint64_t key;          // Board hash mixed with the piece to place
+    int32_t score;         // Best score over that piece's placements
+};
+
+// Scratch for one breadth-first walk
+struct SearchWalk {
+    uint32_t visited[(SEARCH_STATES + 31) / 32];
+    uint16_t queue[SEARCH_STATES];
+    uint64_t footprints[MAX_PLACEMENTS];   // Cells covered by each placement found
+};
+
+struct SearchContext {
+    SearchWeights weights;
+    TTEntry table[TT_SIZE];
+    SearchWalk walk;
+    Placement placements[2][MAX_PLACEMENTS];   // One list per ply
+    uint32_t nodes;        // Boards scored by the last search
+    uint32_t hits;         // Placement sets answered from the table
+};
+
+struct SearchMove {
+    bool hold;             // Hold first, then place the piece that comes out
+    Placement placement;
+    int32_t score;
+};
+
+extern const SearchWeights DEFAULT_WEIGHTS;
+
+// Build the piece masks and Zobrist keys; once, before any search
+void initSearchTables();
+
+void initSearchContext(SearchContext &ctx, const SearchWeights &weights);
+
+// Convert the game's board, where nonzero cells are filled
+void loadSearchBoard(SearchBoard &board, const uint8_t cells[][SEARCH_WIDTH]);
+
+// Every distinct place the piece can come to rest from the spawn, at most
+// MAX_PLACEMENTS; 0 if the spawn itself is blocked. Walks in ctx.walk.
+int generatePlacements(SearchContext &ctx, const SearchBoard &board, int piece,
+                       Placement *out);
+
+// Lock the piece in and clear lines, keeping the hash current. Returns
+// the number of lines cleared.
+int applyPlacement(SearchBoard &board, int piece, const Placement &placement);
+
+int32_t evaluateBoard(const SearchWeights &weights, const SearchBoard &board);
+
+// Two-ply search over the current piece, the next piece and hold. False
+// if no piece can be placed.
+bool findBestMove(SearchContext &ctx, const SearchBoard &board, int current,
+                  int next, int held, bool canHold, SearchMove &move);
+
+#endif
@@ -4,6 +4,13 @@
 #include "games/game2_pinball.h"
 #include "games/game3_skyroads.h"
 #include "games/game4_tetris.h"
+#include "engine/arena.h"
+#include "engine/lcd_batch.h"
+#include "engine/font_cache.h"
+#include "engine/display_list.h"
+#include "engine/screen_capture.h"
+#include "engine/quality_governor.h"
+#include "engine/debug_stats.h"
 
 enum GameState {
     SPLASH,
@@ -14,9 +21,37 @@ enum GameState {
     GAME4
 };
 
+// Game lifecycle: setup on entry, loop every pass, teardown before the
+// arena is reset on the way back to the menu. The frame budget is what
+// the game's loop paces itself to. A batched game draws through lcd_batch
+// and reports the rest to screen capture; any other is captured by reading
+// the panel back.
+struct Game {
+    const char *name;
+    void (*setup)();
+    void (*loop)();
+    void (*teardown)();
+    int frameMs;
+    bool batched;
+};
+
+const Game GAMES[] = {
+    {"Platform", game1Setup, game1Loop, game1Teardown, GAME1_FRAME_MS, false},
+    {"Pinball", game2Setup, game2Loop, game2Teardown, GAME2_FRAME_MS, true},
+    {"Skyroads", game3Setup, game3Loop, game3Teardown, GAME3_FRAME_MS, true},
+    {"Tetris", game4Setup, game4Loop, game4Teardown, GAME4_FRAME_MS, false}
+};
+
 GameState currentState = SPLASH;
 int selectedGame = 0;
 unsigned long splashStartTime = 0;
+size_t arenaPeaks[4];   // Most arena each game has used, 0 if not played
+uint8_t qualityLows[4]; // Deepest quality level each game has run at, plus 1; 0 if never governed
+
+// Time in the game's loop, its own delays included, since it started
+uint32_t passes = 0;
+uint64_t passMicros = 0;
+uint32_t passPeak = 0;
 
 #define FACES_ADDR 0x08
 uint8_t facesData = 0xFF;
@@ -137,6 +172,125 @@ void showMenu() {
     M5.Lcd.setTextSize(1);
     M5.Lcd.setCursor(20, 210);
     M5.Lcd.println("UP/DOWN: Select  A: Play");
+
+    if (arenaPeaks[selectedGame] > 0) {
+        M5.Lcd.setCursor(20, 225);
+        M5.Lcd.printf("Memory: %u / %u bytes", (unsigned)arenaPeaks[selectedGame],
+                      (unsigned)ARENA_SIZE);
+        if (qualityLows[selectedGame] == 1) {
+            M5.Lcd.print("  Quality: full");
+        } else if (qualityLows[selectedGame] > 1) {
+            M5.Lcd.printf("  Quality: down to %d", qualityLows[selectedGame] - 1);
+        }
+    }
+}
+
+void startGame(int game) {
+    arenaReset();
+    currentState = (GameState)(GAME1 + game);
+    resetLcdBatchStats();
+    resetFontStats();
+    resetDisplayTotals();
+    resetQualityStats();
+    passes = 0;
+    passMicros = 0;
+    passPeak = 0;
+    GAMES[game].setup();
+#if SCREEN_CAPTURE
+    startCapture(GAMES[game].name, GAMES[game].batched);
+#endif
+}
+
+void returnToMenu() {
+    int game = currentState - GAME1;
+#if SCREEN_CAPTURE
+    if (capturing()) {
+        stopCapture();
+        const CaptureStats &capture = captureStats();
+        Serial.printf("%s: captured %lu frames, %lu bytes, %lu records dropped\n",
+                      GAMES[game].name, (unsigned long)capture.frames,
+                      (unsigned long)capture.bytes, (unsigned long)capture.dropped);
+        Serial.printf("%s: capture cost %lu us/frame avg, %lu peak, writer %lu ms\n",
+                      GAMES[game].name,
+                      (unsigned long)(capture.micros / (capture.frames ? capture.frames : 1)),
+                      (unsigned long)capture.peakMicros,
+                      (unsigned long)(capture.writeMicros / 1000));
+        Serial.printf("%s: read back %lu rows in %lu ms\n", GAMES[game].name,
+                      (unsigned long)capture.readRows,
+                      (unsigned long)(capture.readMicros / 1000));
+    }
+#endif
+#if DEBUG_STATS || SCREEN_CAPTURE
+    // The writer shares the bus with the panel, so what capture costs the
+    // game shows here too: compare against a build without it
+    if (passes > 0) {
+        Serial.printf("%s: loop pass %lu us avg, %lu peak, capture %s\n", GAMES[game].name,
+                      (unsigned long)(passMicros / passes), (unsigned long)passPeak,
+                      SCREEN_CAPTURE ? "on" : "off");
+    }
+#endif
+    GAMES[game].teardown();
+
+    arenaPeaks[game] = max(arenaPeaks[game], arenaPeak());
+    const QualityStats &governed = qualityStats();
+    for (int level = QUALITY_MAX_LEVELS - 1; level >= 0; level--) {
+        if (governed.frames[level] > 0) {
+            qualityLows[game] = max((int)qualityLows[game], level + 1);
+            break;
+        }
+    }
+#if DEBUG_STATS
+    Serial.printf("%s: arena peak %u of %u bytes\n", GAMES[game].name,
+                  (unsigned)arenaPeak(), (unsigned)ARENA_SIZE);
+
+    // A display list that runs out of items or text loses what comes after
+    const DisplayTotals &display = displayTotals();
+    if (display.frames > 0) {
+        Serial.printf("%s: %lu display list frames, %lu records dropped%s\n", GAMES[game].name,
+                      (unsigned long)display.frames, (unsigned long)display.dropped,
+                      display.dropped > 0 ? ", RAISE MAX_DISPLAY_ITEMS or DISPLAY_TEXT_POOL" : "");
+    }
+
+    // Without batching every span would be a transaction, a window and a push
+    const LcdBatchStats &lcd = lcdBatchStats();
+    if (lcd.spans > 0) {
+        Serial.printf("%s: per frame %lu spans sent as %lu windows, %lu pushes\n",
+                      GAMES[game].name, (unsigned long)(lcd.spans / lcd.frames),
+                      (unsigned long)(lcd.windows / lcd.frames),
+                      (unsigned long)(lcd.pushes / lcd.frames));
+
+        // Bus time is what the panel costs on the device, whatever the
+        // loop's wall time says. Only what went through lcd_batch is
+        // counted here; the host's bus_budget_test counts direct draws too.
+        uint32_t bus = lcdBusMicros(lcd) / lcd.frames;
+        uint32_t unbatched = lcdUnbatchedMicros(lcd) / lcd.frames;
+        Serial.printf("%s: est. bus %lu.%02lu ms per frame (%lu.%02lu unbatched) of %d ms budget%s\n",
+                      GAMES[game].name, (unsigned long)(bus / 1000),
+                      (unsigned long)(bus % 1000 / 10), (unsigned long)(unbatched / 1000),
+                      (unsigned long)(unbatched % 1000 / 10), GAMES[game].frameMs,
+                      bus > GAMES[game].frameMs * 1000UL ? ", OVER" : "");
+    }
+    const QualityStats &quality = qualityStats();
+    if (quality.changes > 0) {
+        Serial.printf("%s: %lu quality changes, frames by level:", GAMES[game].name,
+                      (unsigned long)quality.changes);
+        for (int level = 0; level < QUALITY_MAX_LEVELS; level++) {
+            if (quality.frames[level] > 0) {
+                Serial.printf(" %d:%lu", level, (unsigned long)quality.frames[level]);
+            }
+        }
+        Serial.printf("\n");
+    }
+    const FontStats &font = fontStats();
+    if (font.micros > 0) {
+        Serial.printf("%s: cached text at %lu glyphs/ms\n", GAMES[game].name,
+                      (unsigned long)(font.glyphs * 1000ULL / font.micros));
+    }
+#endif
+    arenaReset();
+
+    currentState = MENU;
+    showMenu();
 }
 
 void setup() {
@@ -216,57 +370,27 @@ void loop() {
 
             // Select game
             if ((facesA && !lastA) || M5.BtnB.wasPressed()) {
-                if (selectedGame == 0) {
-                    currentState = GAME1;
-                    game1Setup();
-                } else if (selectedGame == 1) {
-                    currentState = GAME2;
-                    game2Setup();
-                } else if (selectedGame == 2) {
-                    currentState = GAME3;
-                    game3Setup();
-                } else {
-                    currentState = GAME4;
-                    game4Setup();
-                }
+                startGame(selectedGame);
             }
             break;
 
         case GAME1:
-            game1Loop();
-            // Return to menu with Select button or M5 button long press
-            if ((facesSelect && !lastSelect) || M5.BtnA.pressedFor(2000)) {
-                currentState = MENU;
-                showMenu();
-            }
-            break;
-
         case GAME2:
-            game2Loop();
-            // Return to menu with Select button or M5 button long press
-            if ((facesSelect && !lastSelect) || M5.BtnA.pressedFor(2000)) {
-                currentState = MENU;
-                showMenu();
-            }
-            break;
-
         case GAME3:
-            game3Loop();
-            // Return to menu with Select button or M5 button long press
-            if ((facesSelect && !lastSelect) || M5.BtnA.pressedFor(2000)) {
-                currentState = MENU;
-                showMenu();
-            }
-            break;
-
-        case GAME4:
-            game4Loop();
+        case GAME4: {
+            uint32_t passStart = micros();
+            if (capturing()) captureFrame();
+            GAMES[currentState - GAME1].loop();
+            uint32_t passTime = micros() - passStart;
+            passes++;
+            passMicros += passTime;
+            passPeak = max(passPeak, passTime);
             // Return to menu with Select button or M5 button long press
             if ((facesSelect && !lastSelect) || M5.BtnA.pressedFor(2000)) {
-                currentState = MENU;
-                showMenu();
+                returnToMenu();
             }
             break;
+        }
     }
 
     lastUp = facesUp;
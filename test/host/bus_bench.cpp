@@ -0,0 +1,38 @@
+// Bus time per loop pass for each game's script, priced with lcd_batch's
+// cost model from what actually crossed the bus. Built three times: with
+// batching on, with LCD_BATCH 0 to show what batching saves, and with
+// SCREEN_CAPTURE 1 to show what recording to the card, which shares the
+// bus, costs the frame.
+
+#include "scenario.h"
+#include "engine/lcd_batch.h"
+#include "engine/screen_capture.h"
+#include <sys/stat.h>
+
+#define BENCH_CARD "build/bench_card"
+
+static int benchGame(int game) {
+    BusTotals totals = {};
+    totals.budgetMicros = SCENARIOS[game].frameMs * 1000UL;
+    playScenario(game, measureBusPass, &totals);
+
+    int passes = totals.passes;
+    uint32_t average = totals.micros / passes;
+    printf("%-9s %6u.%02u ms  %6u.%02u ms peak  %3d over %d ms  %6.1f transactions  "
+           "%6.1f windows  %6.1f pushes  %8.0f bytes  %7.0f SD bytes\n",
+           SCENARIOS[game].name, average / 1000, average % 1000 / 10, totals.peak / 1000,
+           totals.peak % 1000 / 10, totals.overBudget, SCENARIOS[game].frameMs,
+           (double)totals.sum.transactions / passes, (double)totals.sum.windows / passes,
+           (double)totals.sum.pushes / passes, (double)totals.sum.bytes / passes,
+           (double)totals.sum.sdBytes / passes);
+    return 0;
+}
+
+int main() {
+    if (SCREEN_CAPTURE) {
+        mkdir(BENCH_CARD, 0777);
+        setScenarioCard(BENCH_CARD);
+    }
+    printf("Per pass, LCD_BATCH %d, SCREEN_CAPTURE %d:\n", LCD_BATCH, SCREEN_CAPTURE);
+    return forEachGame(benchGame);
+}
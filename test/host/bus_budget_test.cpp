@@ -0,0 +1,93 @@
+// Bus time per pass for each game's script against bus_baseline.txt, with
+// every transaction on the bus counted, direct M5.Lcd draws included.
+// Average bus time may not grow past the baseline by more than
+// BUS_TOLERANCE percent, nor may more passes go over the game's frame
+// budget than the baseline had. No display list may drop records, which
+// would make a frame cheaper by leaving things out.
+//
+// After a change that is meant to move the numbers, rerun with --update
+// (make baseline) and commit the new file.
+
+#include "scenario.h"
+#include "check.h"
+#include "engine/display_list.h"
+#include <string.h>
+
+#define BUS_BASELINE "bus_baseline.txt"
+#define BUS_TOLERANCE 5        // Percent
+
+struct BusBaseline {
+    uint32_t average;          // Microseconds per pass
+    uint32_t peak;
+    int overBudget;
+};
+
+static BusBaseline baseline[SCENARIO_GAMES];
+static bool found[SCENARIO_GAMES];
+static bool updating = false;
+
+// One "game average peak over" line per game, '#' lines skipped
+static void readBaseline() {
+    FILE *f = fopen(BUS_BASELINE, "r");
+    if (!f) return;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        char name[32];
+        BusBaseline entry;
+        if (line[0] == '#' || sscanf(line, "%31s %u %u %d", name, &entry.average, &entry.peak,
+                                     &entry.overBudget) != 4) {
+            continue;
+        }
+        for (int game = 0; game < SCENARIO_GAMES; game++) {
+            if (strcmp(name, SCENARIOS[game].name) != 0) continue;
+            baseline[game] = entry;
+            found[game] = true;
+        }
+    }
+    fclose(f);
+}
+
+// Games run one child at a time, so when updating each appends its line
+static int measureGame(int game) {
+    BusTotals totals = {};
+    totals.budgetMicros = SCENARIOS[game].frameMs * 1000UL;
+    playScenario(game, measureBusPass, &totals);
+    uint32_t average = totals.micros / totals.passes;
+    const char *name = SCENARIOS[game].name;
+
+    if (updating) {
+        FILE *f = fopen(BUS_BASELINE, "a");
+        if (!f) return 1;
+        fprintf(f, "%-9s %6u %6u %4d\n", name, average, totals.peak, totals.overBudget);
+        return fclose(f) == 0 ? 0 : 1;
+    }
+
+    printf("%s: %u us per pass (baseline %u), %d passes over %d ms (baseline %d)\n", name,
+           average, baseline[game].average, totals.overBudget, SCENARIOS[game].frameMs,
+           baseline[game].overBudget);
+    if (!found[game]) {
+        printf("%s: not in " BUS_BASELINE ", run make baseline\n", name);
+        return 1;
+    }
+    CHECK(average <= (uint64_t)baseline[game].average * (100 + BUS_TOLERANCE) / 100);
+    CHECK(totals.overBudget <= baseline[game].overBudget);
+    CHECK(displayTotals().dropped == 0);
+    if (average < (uint64_t)baseline[game].average * (100 - BUS_TOLERANCE) / 100) {
+        printf("%s: well under the baseline, run make baseline to keep it\n", name);
+    }
+    return checkFailures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    updating = argc > 1 && strcmp(argv[1], "--update") == 0;
+    if (updating) {
+        FILE *f = fopen(BUS_BASELINE, "w");
+        if (!f) return 1;
+        fprintf(f, "# game, average and peak bus us per pass, passes over the frame budget\n");
+        fclose(f);
+    } else {
+        readBaseline();
+    }
+    checkFailures += forEachGame(measureGame);
+    return checkResult("bus_budget_test");
+}
@@ -0,0 +1,68 @@
+// lcd_batch holds the bus for a whole frame, but In_eSPI's shape and text
+// calls drop CS when they finish, even inside a transaction someone else
+// opened. Every address window lcd_batch sends has to reach the panel
+// regardless, or the pixels after it land wherever the last one was.
+
+#include "scenario.h"
+#include "check.h"
+#include "engine/lcd_batch.h"
+
+static uint16_t pixelAt(int x, int y) {
+    return hostScreen()[y * HOST_LCD_WIDTH + x];
+}
+
+static bool rowIs(int x, int y, int w, uint16_t color) {
+    for (int i = 0; i < w; i++) {
+        if (pixelAt(x + i, y) != color) return false;
+    }
+    return true;
+}
+
+static void checkDirectDrawInFrame() {
+    M5.Lcd.fillScreen(TFT_BLACK);
+    resetHostBusStats();
+
+    uint16_t image[20];
+    for (int i = 0; i < 20; i++) image[i] = (uint16_t)(TFT_YELLOW >> 8 | TFT_YELLOW << 8);
+
+    beginLcdFrame();
+    lcdSpan(10, 10, 20, TFT_RED);
+    lcdSpan(10, 11, 20, TFT_RED);
+    lcdBatchBreak();
+    M5.Lcd.drawRect(100, 100, 10, 10, TFT_GREEN);
+    M5.Lcd.setCursor(200, 200);
+    M5.Lcd.setTextColor(TFT_WHITE);
+    M5.Lcd.print("x");
+    lcdSpan(10, 12, 20, TFT_BLUE);
+    lcdSpan(10, 13, 20, TFT_BLUE);
+    lcdPixels(40, 50, 20, image);
+    lcdWindow(60, 60, 4, 5);
+    for (int i = 0; i < 5; i++) lcdStream(image, 4);
+    endLcdFrame();
+
+    CHECK(hostBusStats().unheld == 0);
+    CHECK(rowIs(10, 10, 20, TFT_RED));
+    CHECK(rowIs(10, 11, 20, TFT_RED));
+    CHECK(rowIs(10, 12, 20, TFT_BLUE));
+    CHECK(rowIs(10, 13, 20, TFT_BLUE));
+    CHECK(rowIs(100, 100, 10, TFT_GREEN));
+    CHECK(rowIs(40, 50, 20, TFT_YELLOW));
+    for (int y = 60; y < 65; y++) CHECK(rowIs(60, y, 4, TFT_YELLOW));
+}
+
+static void ignorePass(int, void *) {}
+
+// Titles, play and end screens, with whatever each draws directly
+static int checkGame(int game) {
+    playScenario(game, ignorePass, NULL);
+    const HostBusStats &bus = hostBusStats();
+    printf("%s: %u windows, %u lost with CS high\n", SCENARIOS[game].name,
+           (unsigned)bus.windows, (unsigned)bus.unheld);
+    return bus.unheld == 0 ? 0 : 1;
+}
+
+int main() {
+    checkDirectDrawInFrame();
+    checkFailures += forEachGame(checkGame);
+    return checkResult("bus_test");
+}
@@ -0,0 +1,136 @@
+// Screen capture round trip: each game's script played with SCREEN_CAPTURE
+// 1, the file rebuilt by tools/capture_frames.py, and its frames checked
+// against the panel every CAPTURE_EVERY passes. A frame with nothing lost
+// and nothing still to read back has to match the panel exactly; any
+// other, which is every frame of a game drawing straight to M5.Lcd, only
+// in the rows read back for it. Records are dropped here only when a pass
+// draws more than the two buffers hold, as pinball's first playfield
+// does and Skyroads' scrolling one does every pass. The rebuilt frames
+// are left in build/capture_frames/<game>/ to look at.
+
+#include "scenario.h"
+#include "check.h"
+#include "engine/screen_capture.h"
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+#define CAPTURE_EVERY 20
+#define CAPTURE_CARD "build/capture_card"
+#define CAPTURE_FRAMES "build/capture_frames"
+#define CAPTURE_TOOL "../../tools/capture_frames.py"
+
+#define SCREEN_PIXELS (HOST_LCD_WIDTH * HOST_LCD_HEIGHT)
+
+// The panel by frame number: frame n is the screen as pass n found it,
+// so the one after pass n - 1
+struct CaptureRun {
+    std::vector<std::vector<uint16_t>> screens;
+};
+
+static void savePass(int pass, void *context) {
+    CaptureRun &run = *(CaptureRun *)context;
+    if ((pass + 1) % CAPTURE_EVERY != 0) return;
+    run.screens.resize(pass + 2);
+    run.screens[pass + 1].assign(hostScreen(), hostScreen() + SCREEN_PIXELS);
+}
+
+static bool readRaw(const char *dir, int frame, std::vector<uint16_t> &pixels) {
+    char path[96];
+    snprintf(path, sizeof(path), "%s/frame%05d.raw", dir, frame);
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t bytes[SCREEN_PIXELS * 2];
+    bool whole = fread(bytes, 1, sizeof(bytes), f) == sizeof(bytes);
+    fclose(f);
+    pixels.resize(SCREEN_PIXELS);
+    for (int i = 0; i < SCREEN_PIXELS; i++) pixels[i] = bytes[2 * i] << 8 | bytes[2 * i + 1];
+    return whole;
+}
+
+static bool rowMatches(const std::vector<uint16_t> &a, const std::vector<uint16_t> &b, int y) {
+    return memcmp(&a[y * HOST_LCD_WIDTH], &b[y * HOST_LCD_WIDTH],
+                  HOST_LCD_WIDTH * sizeof(uint16_t)) == 0;
+}
+
+static void reportMismatch(const char *name, int frame, int y) {
+    printf("%s: frame %d rebuilt differs from the panel at row %d\n", name, frame, y);
+    checkFailures++;
+}
+
+static int checkGame(int game) {
+    const char *name = SCENARIOS[game].name;
+    mkdir(CAPTURE_CARD, 0777);
+    setScenarioCard(CAPTURE_CARD);
+
+    CaptureRun run;
+    playScenario(game, savePass, &run);
+    stopCapture();
+    const CaptureStats &stats = captureStats();
+
+    char dir[64], command[256];
+    snprintf(dir, sizeof(dir), CAPTURE_FRAMES "/%s", name);
+    snprintf(command, sizeof(command),
+             "python3 " CAPTURE_TOOL " " CAPTURE_CARD CAPTURE_DIR "/%s.cap %s --raw --every %d",
+             name, dir, CAPTURE_EVERY);
+    if (system(command) != 0) {
+        printf("%s: %s failed\n", name, command);
+        return 1;
+    }
+
+    char path[96];
+    snprintf(path, sizeof(path), "%s/index.txt", dir);
+    FILE *index = fopen(path, "r");
+    if (!index) {
+        printf("%s: no %s\n", name, path);
+        return 1;
+    }
+
+    // Frame, millis, flags, then the rows read back, comma separated
+    int frame, flags, exact = 0, partial = 0, rowsChecked = 0;
+    unsigned long millis;
+    char rows[1024];
+    std::vector<uint16_t> rebuilt;
+    while (fscanf(index, "%d %lu %d %1023s", &frame, &millis, &flags, rows) == 4) {
+        if (frame >= (int)run.screens.size() || run.screens[frame].empty()) continue;
+        const std::vector<uint16_t> &want = run.screens[frame];
+        if (!readRaw(dir, frame, rebuilt)) {
+            printf("%s: frame %d missing\n", name, frame);
+            checkFailures++;
+            continue;
+        }
+
+        if (!(flags & (CAPTURE_GAP | CAPTURE_STALE))) {
+            exact++;
+            for (int y = 0; y < HOST_LCD_HEIGHT; y++) {
+                if (!rowMatches(want, rebuilt, y)) {
+                    reportMismatch(name, frame, y);
+                    break;
+                }
+            }
+            continue;
+        }
+        partial++;
+        for (char *row = strtok(rows, ","); row && strcmp(row, "-") != 0;
+             row = strtok(NULL, ",")) {
+            int y = atoi(row);
+            rowsChecked++;
+            if (!rowMatches(want, rebuilt, y)) {
+                reportMismatch(name, frame, y);
+                break;
+            }
+        }
+    }
+    fclose(index);
+
+    printf("%s: %lu frames captured, %lu records dropped; %d checked whole, %d by %d rows "
+           "read back\n", name, (unsigned long)stats.frames, (unsigned long)stats.dropped,
+           exact, partial, rowsChecked);
+    CHECK(exact + partial == (int)run.screens.size() / CAPTURE_EVERY);
+    return checkFailures ? 1 : 0;
+}
+
+int main() {
+    checkFailures += forEachGame(checkGame);
+    return checkResult("capture_test");
+}
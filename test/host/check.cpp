@@ -0,0 +1,12 @@
+#include "check.h"
+
+int checkFailures = 0;
+
+int checkResult(const char *test) {
+    if (checkFailures) {
+        printf("%s: %d failed\n", test, checkFailures);
+        return 1;
+    }
+    printf("%s: ok\n", test);
+    return 0;
+}
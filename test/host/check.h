@@ -0,0 +1,20 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+// Count a failure and carry on, so one run reports everything wrong
+extern int checkFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);  \
+            checkFailures++;                                                 \
+        }                                                                    \
+    } while (0)
+
+// Exit status for main: reports and returns 1 if anything failed
+int checkResult(const char *test);
+
+#endif
@@ -0,0 +1,51 @@
+// Glyphs per millisecond for a HUD string, cached against printed. Two
+// figures each: bus time as lcd_batch's cost model prices what crossed
+// the bus, which is what bounds it on the device, and host CPU time. The
+// shim prints straight into its framebuffer, so the CPU figure is what
+// composing cached text costs, not what printing costs on the device.
+
+#include "scenario.h"
+#include "engine/font_cache.h"
+#include "engine/lcd_batch.h"
+#include <time.h>
+
+#define DRAWS 2000
+
+static FontCache cache;
+
+static double hostMillis() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+static void bench(const char *label, const char *text, bool useCache) {
+    int glyphs = strlen(text) * DRAWS;
+    resetHostBusStats();
+    double start = hostMillis();
+    for (int i = 0; i < DRAWS; i++) {
+        if (useCache) {
+            drawCachedText(cache, 5, 2, text, TFT_YELLOW, TFT_BLACK);
+        } else {
+            M5.Lcd.setTextSize(cache.size);
+            M5.Lcd.setTextColor(TFT_YELLOW, TFT_BLACK);
+            M5.Lcd.setCursor(5, 2);
+            M5.Lcd.print(text);
+        }
+    }
+    double cpu = hostMillis() - start;
+    double bus = busMicros(hostBusStats()) / 1000.0;
+    printf("  %-8s %8.1f glyphs/ms on the bus  %10.1f glyphs/ms host CPU  %6.1f bytes/glyph\n",
+           label, glyphs / bus, glyphs / cpu, (double)hostBusStats().bytes / glyphs);
+}
+
+int main() {
+    const char *text = "Score:123456";
+    for (int size = 1; size <= 2; size++) {
+        cacheFont(cache, "Score:0123456789 ", size);
+        printf("\"%s\" at size %d, %d draws:\n", text, size, DRAWS);
+        bench("printed", text, false);
+        bench("cached", text, true);
+    }
+    return 0;
+}
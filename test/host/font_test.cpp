@@ -0,0 +1,65 @@
+// Cached HUD text has to come out exactly as printed text would, including
+// in the middle of a batched frame, where drawCachedText's window follows
+// queued spans and a printed fallback drops CS behind lcd_batch's back.
+
+#include "check.h"
+#include "shim/host.h"
+#include "engine/font_cache.h"
+#include "engine/lcd_batch.h"
+
+#define SCREEN_PIXELS (HOST_LCD_WIDTH * HOST_LCD_HEIGHT)
+
+static FontCache cache;
+static uint16_t printed[SCREEN_PIXELS];
+
+// Spans either side of the text, as a HUD drawn with the playfield has
+static void drawAround(bool batched) {
+    for (int y = 40; y < 44; y++) {
+        if (batched) {
+            lcdSpan(0, y, 200, TFT_BLUE);
+        } else {
+            M5.Lcd.drawFastHLine(0, y, 200, TFT_BLUE);
+        }
+    }
+}
+
+static void checkText(int x, int y, const char *text, uint16_t color) {
+    M5.Lcd.fillScreen(TFT_BLACK);
+    drawAround(false);
+    M5.Lcd.setTextSize(cache.size);
+    M5.Lcd.setTextColor(color, TFT_BLACK);
+    M5.Lcd.setCursor(x, y);
+    M5.Lcd.print(text);
+    drawAround(false);
+    memcpy(printed, hostScreen(), sizeof(printed));
+
+    M5.Lcd.fillScreen(TFT_BLACK);
+    resetHostBusStats();
+    beginLcdFrame();
+    drawAround(true);
+    drawCachedText(cache, x, y, text, color, TFT_BLACK);
+    drawAround(true);
+    endLcdFrame();
+
+    CHECK(hostBusStats().unheld == 0);
+    if (memcmp(printed, hostScreen(), sizeof(printed)) != 0) {
+        printf("font_test: \"%s\" at size %d differs from printed text\n", text, cache.size);
+        checkFailures++;
+    }
+}
+
+int main() {
+    for (int size = 1; size <= 2; size++) {
+        CHECK(cacheFont(cache, "Score:Lives0123456789 ", size));
+        checkText(5, 2, "Score:1234  ", TFT_YELLOW);
+        checkText(220, 2, "Lives:3", TFT_YELLOW);
+        checkText(5, 46, "Score:90210 ", TFT_WHITE);
+        checkText(5, 46, "Best:42", TFT_WHITE);         // Not all cached: printed
+        checkText(300, 230, "Score", TFT_WHITE);        // Off the edge: printed
+    }
+
+    // Rows past 32 bits wide can't be cached: refused, and printed instead
+    CHECK(!cacheFont(cache, "Score", FONT_MAX_SIZE + 1));
+    checkText(5, 2, "Score", TFT_YELLOW);
+    return checkResult("font_test");
+}
@@ -0,0 +1,106 @@
+// Golden screens: each game's script played from boot, with the whole
+// panel hashed every GOLDEN_EVERY passes and checked against golden/, so
+// a change that alters what ends up on screen, by any path, shows. A
+// display list dropping records fails too: the screens would be missing
+// whatever didn't fit.
+//
+// A mismatch saves the screen as build/<game>-<pass>.ppm. After a change
+// that is meant to alter the picture, look at those, then rerun with
+// --update (make golden) and commit the new files.
+
+#include "scenario.h"
+#include "check.h"
+#include "engine/display_list.h"
+#include <string.h>
+
+#define GOLDEN_EVERY 20
+#define GOLDEN_DIR "golden"
+#define GOLDEN_MAX 64
+
+struct GoldenRun {
+    const char *name;
+    uint64_t want[GOLDEN_MAX];
+    int wantCount;
+    uint64_t got[GOLDEN_MAX];
+    int gotCount;
+    int failures;
+};
+
+static bool updating = false;
+
+static void goldenPath(char *path, size_t size, const char *name) {
+    snprintf(path, size, GOLDEN_DIR "/%s.txt", name);
+}
+
+// One "pass hash" line per checkpoint, in pass order
+static bool readGolden(GoldenRun &run) {
+    char path[64];
+    goldenPath(path, sizeof(path), run.name);
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    int pass;
+    unsigned long long hash;
+    while (run.wantCount < GOLDEN_MAX && fscanf(f, "%d %llx", &pass, &hash) == 2) {
+        CHECK(pass == run.wantCount * GOLDEN_EVERY);
+        run.want[run.wantCount++] = hash;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool writeGolden(const GoldenRun &run) {
+    char path[64];
+    goldenPath(path, sizeof(path), run.name);
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    for (int i = 0; i < run.gotCount; i++) {
+        fprintf(f, "%d %016llx\n", i * GOLDEN_EVERY, (unsigned long long)run.got[i]);
+    }
+    return fclose(f) == 0;
+}
+
+static void checkPass(int pass, void *context) {
+    GoldenRun &run = *(GoldenRun *)context;
+    if (pass % GOLDEN_EVERY != 0 || run.gotCount == GOLDEN_MAX) return;
+    int index = run.gotCount;
+    uint64_t hash = hostScreenHash();
+    run.got[run.gotCount++] = hash;
+    if (updating || index >= run.wantCount || hash == run.want[index]) return;
+
+    char path[64];
+    snprintf(path, sizeof(path), "build/%s-%d.ppm", run.name, pass);
+    hostWritePPM(path);
+    printf("%s: pass %d screen %016llx, want %016llx, saved %s\n", run.name, pass,
+           (unsigned long long)hash, (unsigned long long)run.want[index], path);
+    run.failures++;
+}
+
+static int checkGame(int game) {
+    GoldenRun run = {};
+    run.name = SCENARIOS[game].name;
+    bool found = readGolden(run);
+    if (!found && !updating) {
+        printf("%s: no " GOLDEN_DIR "/%s.txt, run make golden\n", run.name, run.name);
+        return 1;
+    }
+
+    playScenario(game, checkPass, &run);
+
+    if (updating) {
+        if (!writeGolden(run)) return 1;
+        printf("%s: recorded %d screens\n", run.name, run.gotCount);
+        return 0;
+    }
+    CHECK(displayTotals().dropped == 0);
+    if (run.gotCount != run.wantCount) {
+        printf("%s: %d screens, want %d\n", run.name, run.gotCount, run.wantCount);
+        run.failures++;
+    }
+    return run.failures + checkFailures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    updating = argc > 1 && strcmp(argv[1], "--update") == 0;
+    checkFailures += forEachGame(checkGame);
+    return checkResult("golden_test");
+}
@@ -0,0 +1,63 @@
+// Ball-steps per second through updateBalls on the built-in table, for
+// 1 to MAX_BALLS balls in play. Each count runs for BENCH_MS of wall
+// time; a drained ball is put back somewhere open so the count holds.
+
+#include "games/game2_pinball.cpp"
+
+#include <time.h>
+
+#define BENCH_MS 500
+#define BENCH_SEED 4242
+
+static double hostMillis() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+// A random spot clear of the table and moving, as a ball in play would be
+static void placeBall(int i) {
+    SDFSample sample;
+    do {
+        balls.x[i] = random(20, SCREEN_WIDTH - 20);
+        balls.y[i] = random(40, 180);
+    } while (!sampleTableSDF(*tableSDF, *table, balls.x[i], balls.y[i], sample) ||
+             sample.dist < 2 * BALL_RADIUS);
+    balls.vx[i] = random(-800, 800) / 100.0;
+    balls.vy[i] = random(-1000, 200) / 100.0;
+    balls.color[i] = BALL_COLORS[i];
+    balls.order[i] = i;
+}
+
+static void benchBalls(int count) {
+    randomSeed(BENCH_SEED + count);
+    setupPinball();
+    for (int i = 0; i < count; i++) placeBall(i);
+    balls.count = count;
+
+    uint64_t steps = 0, ballSteps = 0;
+    uint32_t input = 0xFF;
+    double start = hostMillis(), elapsed = 0;
+    while (elapsed < BENCH_MS) {
+        for (int n = 0; n < 100; n++) {
+            // Flap both flippers now and then, as play does
+            if (steps % 40 == 0) input ^= 0x0C;
+            updateFlippers(input);
+            ballSteps += balls.count;
+            updateBalls();
+            steps++;
+            while (balls.count < count) placeBall(balls.count++);
+        }
+        elapsed = hostMillis() - start;
+    }
+    printf("%d ball%s  %10.0f steps/s  %10.0f ball-steps/s\n", count, count == 1 ? " " : "s",
+           steps * 1000.0 / elapsed, ballSteps * 1000.0 / elapsed);
+}
+
+int main() {
+    game2Setup();
+    buildTableSDF(*tableSDF, *table);
+    printf("updateBalls on the built-in table, %d ms each:\n", BENCH_MS);
+    for (int count = 1; count <= MAX_BALLS; count++) benchBalls(count);
+    return 0;
+}
@@ -0,0 +1,371 @@
+// Pinball physics fuzzer: randomized launches, multiball and flipper
+// patterns on the built-in table and on one of thin segments, arcs and
+// boosting slingshots, spread over one worker process per core. Speeds are never
+// clamped here, so what it reports is what the physics does on its own.
+//
+//   pinball_fuzz [runs]       FUZZ_RUNS when not given (make fuzz RUNS=n)
+//
+// Fails (exit 1) on any of:
+//   - a position or velocity that is not finite
+//   - a ball ending a step inside the table, off the screen, or on the far
+//     side of a segment, an arc or a flipper blade, or through a bumper
+//   - a run going faster than FUZZ_SPEED_LIMIT
+//   - a passive step, both flippers still, gaining more energy than gravity
+//     and boosts account for: a ball in reach of a boosting primitive may
+//     be kicked up to TABLE_BOOST_SPEED, no further
+//
+// Peak speeds are also reported as a histogram; they are what
+// MAX_BALL_SPEED is set from.
+
+#define BALL_SPEED_CAP 0
+#include "games/game2_pinball.cpp"
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#define FUZZ_RUNS 4000
+#define FUZZ_MAX_STEPS 3000
+#define FUZZ_SEED 12345
+#define SPEED_BINS 8           // Peak speed histogram, FUZZ_BIN px/tick wide
+#define FUZZ_BIN 10
+
+// Flipper shots are the fastest thing on the table: a ball that has
+// fallen the height of the screen comes off a blade swinging the other way
+// at FLIPPER_RESTITUTION of its speed plus 1.7 times the tip speed, about
+// 31 px/tick, a little more with another ball behind it. Past this,
+// energy is coming from somewhere it shouldn't.
+#define FUZZ_SPEED_LIMIT 40.0
+
+// Runs are split evenly between these, NULL being the built-in table
+static const char *const FUZZ_TABLES[] = {
+    NULL,
+    "wall 5 240 5 25\n"
+    "wall 5 25 315 25\n"
+    "wall 315 25 315 240\n"
+    "arc 160 140 100 30 150 CYAN\n"
+    "arc 60 100 25 90 270 GREEN\n"
+    "seg 120 80 200 80 RED\n"
+    "seg 230 110 231 150 RED\n"
+    "seg 40 170 70 200 WHITE 1.3\n"          // Slingshots
+    "seg 270 170 250 200 WHITE 1.3\n"
+    "bumper 160 150 10 RED 100\n"
+    "bumper 110 130 8 ORANGE 50\n",
+};
+#define FUZZ_TABLE_COUNT (int)(sizeof(FUZZ_TABLES) / sizeof(FUZZ_TABLES[0]))
+
+// Energy a passive step may gain: a push out of the table lifts the ball
+// by at most its radius. A boost on top of that kicks a ball to
+// TABLE_BOOST_SPEED at most, and a faster ball not at all.
+#define ENERGY_SLACK (GRAVITY * TICK_SCALE * TICK_SCALE * BALL_RADIUS)
+#define BOOST_ENERGY (0.5 * TABLE_BOOST_SPEED * TABLE_BOOST_SPEED)
+
+struct FuzzResult {
+    uint64_t ballSteps;
+    uint32_t nonFinite;
+    uint32_t tunnels;
+    uint32_t overLimit;               // Runs past FUZZ_SPEED_LIMIT
+    uint32_t energyGains;
+    float worstGain;
+    float peakSpeed;
+    uint32_t speedBins[SPEED_BINS];   // Runs by their peak speed
+    uint32_t overCap;                 // Runs that went past MAX_BALL_SPEED
+    int firstFailure;                 // Run to replay, -1 if none
+    double millis;                    // Wall time the worker took
+};
+
+static int fuzzRuns = FUZZ_RUNS;
+
+static float prevX[MAX_BALLS], prevY[MAX_BALLS];
+
+// Potential is taken from the top of the screen, y grows downward
+static float ballEnergy(int i) {
+    return 0.5 * (balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i]) -
+           GRAVITY * balls.y[i];
+}
+
+// True if the ball went from one side of the flipper blade to the other
+static bool crossedFlipper(const Flipper &f, int i) {
+    float r0 = f.prevAngle * PI / 180.0;
+    float r1 = f.angle * PI / 180.0;
+    float dx0 = cos(r0), dy0 = -sin(r0);
+    float dx1 = cos(r1), dy1 = -sin(r1);
+
+    float px0 = prevX[i] - f.x, py0 = prevY[i] - f.y;
+    float px1 = balls.x[i] - f.x, py1 = balls.y[i] - f.y;
+    float along0 = px0 * dx0 + py0 * dy0;
+    float along1 = px1 * dx1 + py1 * dy1;
+    if (along0 < 0 || along0 > FLIPPER_LENGTH || along1 < 0 || along1 > FLIPPER_LENGTH) {
+        return false;
+    }
+
+    float side0 = dx0 * py0 - dy0 * px0;
+    float side1 = dx1 * py1 - dy1 * px1;
+    return (side0 > 0 && side1 < 0) || (side0 < 0 && side1 > 0);
+}
+
+static float cross(float ax, float ay, float bx, float by) {
+    return ax * by - ay * bx;
+}
+
+// True if the ball's centre went through the line of a segment, or
+// through an arc or into a bumper, which a bounce off them never does
+static bool crossedTablePrim(const TablePrim &p, int i) {
+    float x0 = prevX[i], y0 = prevY[i];
+    float x1 = balls.x[i], y1 = balls.y[i];
+    if (p.type == PRIM_SEGMENT) {
+        float ex = p.x2 - p.x1, ey = p.y2 - p.y1;
+        float s0 = cross(ex, ey, x0 - p.x1, y0 - p.y1);
+        float s1 = cross(ex, ey, x1 - p.x1, y1 - p.y1);
+        float t0 = cross(x1 - x0, y1 - y0, p.x1 - x0, p.y1 - y0);
+        float t1 = cross(x1 - x0, y1 - y0, p.x2 - x0, p.y2 - y0);
+        return s0 * s1 < 0 && t0 * t1 < 0;
+    }
+    if (p.type == PRIM_ARC) {
+        // Where the path meets the circle, if it does so inside the arc
+        float ex = x1 - x0, ey = y1 - y0;
+        float fx = x0 - p.x1, fy = y0 - p.y1;
+        float a = ex * ex + ey * ey;
+        float b = 2 * (fx * ex + fy * ey);
+        float c = fx * fx + fy * fy - p.radius * p.radius;
+        float disc = b * b - 4 * a * c;
+        if (a == 0 || disc < 0) return false;
+        for (int root = -1; root <= 1; root += 2) {
+            float t = (-b + root * sqrt(disc)) / (2 * a);
+            if (t < 0 || t > 1) continue;
+            float angle = atan2(-(fy + t * ey), fx + t * ex) * 180.0 / PI;
+            if (angle < p.a0) angle += 360;
+            if (angle <= p.a1) return true;
+        }
+        return false;
+    }
+    if (p.type == PRIM_BUMPER) {
+        // Closest the path came to the centre
+        float ex = x1 - x0, ey = y1 - y0;
+        float lengthSq = ex * ex + ey * ey;
+        float t = lengthSq > 0 ? ((p.x1 - x0) * ex + (p.y1 - y0) * ey) / lengthSq : 0;
+        t = constrain(t, 0.0f, 1.0f);
+        return hypot(x0 + t * ex - p.x1, y0 + t * ey - p.y1) < p.radius;
+    }
+    return false;
+}
+
+static bool tunneled(int i) {
+    if (balls.x[i] < 0 || balls.x[i] >= SCREEN_WIDTH || balls.y[i] < 0) return true;
+    SDFSample sample;
+    if (sampleTableSDF(*tableSDF, *table, balls.x[i], balls.y[i], sample) && sample.dist < 0) {
+        return true;
+    }
+    for (int p = 0; p < table->primCount; p++) {
+        if (crossedTablePrim(table->prims[p], i)) return true;
+    }
+    return crossedFlipper(leftFlipper, i) || crossedFlipper(rightFlipper, i);
+}
+
+// True if ball i could reach a boosting primitive this step, moving at
+// the given speed
+static bool nearBoost(int i, float speed) {
+    float reach = BALL_RADIUS + 1 + speed;
+    for (int p = 0; p < table->primCount; p++) {
+        if (table->prims[p].boost <= 1) continue;
+        float nx, ny;
+        if (tablePrimDistance(table->prims[p], balls.x[i], balls.y[i], nx, ny) < reach) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One fuzz step, checked. Returns false if the run should stop.
+static bool fuzzStep(uint32_t input, FuzzResult &result, bool &failed) {
+    updateFlippers(input);
+
+    int n = balls.count;
+    bool passive = leftFlipper.angularVelocity == 0 && rightFlipper.angularVelocity == 0;
+    float before = 0;
+    float fastest = 0;
+    for (int i = 0; i < n; i++) {
+        prevX[i] = balls.x[i];
+        prevY[i] = balls.y[i];
+        before += ballEnergy(i);
+        fastest = max(fastest, (float)sqrt(balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i]));
+    }
+
+    // Colliding balls trade speed and push each other up to a radius, so
+    // with company any ball may get as far as the fastest one could
+    float allowed = n * ENERGY_SLACK;
+    float reach = n > 1 ? fastest + BALL_RADIUS : fastest;
+    for (int i = 0; i < n; i++) {
+        if (nearBoost(i, reach)) allowed += BOOST_ENERGY;
+    }
+
+    updateBalls();
+    result.ballSteps += n;
+    if (balls.count == 0) return false;
+
+    float after = 0;
+    for (int i = 0; i < balls.count; i++) {
+        float speed = sqrt(balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i]);
+        if (!isfinite(balls.x[i]) || !isfinite(balls.y[i]) || !isfinite(speed)) {
+            result.nonFinite++;
+            failed = true;
+            return false;
+        }
+        result.peakSpeed = max(result.peakSpeed, speed);
+        after += ballEnergy(i);
+
+        // Drains reorder the arrays, so only steps that kept every ball
+        // can be matched up with where they were
+        if (balls.count != n) continue;
+        if (tunneled(i)) {
+            result.tunnels++;
+            failed = true;
+        }
+    }
+
+    if (passive && balls.count == n && after - before > allowed) {
+        result.energyGains++;
+        result.worstGain = max(result.worstGain, after - before);
+        failed = true;
+    }
+    return true;
+}
+
+static void fuzzRun(int run, FuzzResult &result) {
+    randomSeed(FUZZ_SEED + run);
+    setupPinball();
+    addBall(-random(0, 400) / 100.0, -8 - random(0, 600) / 100.0);
+    for (int extra = random(0, 4); extra > 0; extra--) {
+        startMultiball();
+    }
+
+    // Each flipper follows its own bit pattern, held for a random period
+    uint32_t pattern = random(0x7FFFFFFF);
+    int period = random(2, 30);
+    float peakBefore = result.peakSpeed;
+    result.peakSpeed = 0;
+    bool failed = false;
+    for (int step = 0; step < FUZZ_MAX_STEPS; step++) {
+        int bit = (step / period) % 31;
+        uint32_t input = 0xFF;
+        if (pattern & (1UL << bit)) input &= ~0x04;
+        if (pattern & (1UL << ((bit + 11) % 31))) input &= ~0x08;
+        delay(PHYSICS_PERIOD_MS);   // Bumper scoring is spaced in time
+        if (!fuzzStep(input, result, failed)) break;
+    }
+
+    result.speedBins[min((int)(result.peakSpeed / FUZZ_BIN), SPEED_BINS - 1)]++;
+    result.overCap += result.peakSpeed > MAX_BALL_SPEED;
+    if (result.peakSpeed > FUZZ_SPEED_LIMIT) {
+        result.overLimit++;
+        failed = true;
+    }
+    result.peakSpeed = max(result.peakSpeed, peakBefore);
+    if (failed && result.firstFailure < 0) result.firstFailure = run;
+}
+
+static double hostMillis() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+static FuzzResult fuzzWorker(int worker, int workers) {
+    FuzzResult result = {};
+    result.firstFailure = -1;
+    double start = hostMillis();
+    game2Setup();
+    int loaded = -1;
+    for (int run = worker; run < fuzzRuns; run += workers) {
+        int which = (int)((int64_t)run * FUZZ_TABLE_COUNT / fuzzRuns);
+        if (which != loaded) {
+            if (FUZZ_TABLES[which]) {
+                parseTable(*table, FUZZ_TABLES[which]);
+            } else {
+                loadTable(*table);
+            }
+            buildTableSDF(*tableSDF, *table);
+            loaded = which;
+        }
+        fuzzRun(run, result);
+    }
+    result.millis = hostMillis() - start;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) fuzzRuns = atoi(argv[1]);
+    if (fuzzRuns <= 0) {
+        printf("usage: pinball_fuzz [runs]\n");
+        return 1;
+    }
+    double start = hostMillis();
+    int workers = max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    std::vector<int> pipes(workers);
+    for (int w = 0; w < workers; w++) {
+        int fds[2];
+        if (pipe(fds) != 0) return 1;
+        if (fork() == 0) {
+            close(fds[0]);
+            FuzzResult result = fuzzWorker(w, workers);
+            bool sent = write(fds[1], &result, sizeof(result)) == sizeof(result);
+            _exit(sent ? 0 : 1);
+        }
+        close(fds[1]);
+        pipes[w] = fds[0];
+    }
+
+    FuzzResult total = {};
+    total.firstFailure = -1;
+    bool lost = false;
+    for (int w = 0; w < workers; w++) {
+        FuzzResult result;
+        lost |= read(pipes[w], &result, sizeof(result)) != sizeof(result);
+        close(pipes[w]);
+        total.ballSteps += result.ballSteps;
+        total.nonFinite += result.nonFinite;
+        total.tunnels += result.tunnels;
+        total.overLimit += result.overLimit;
+        total.energyGains += result.energyGains;
+        total.worstGain = max(total.worstGain, result.worstGain);
+        total.peakSpeed = max(total.peakSpeed, result.peakSpeed);
+        for (int b = 0; b < SPEED_BINS; b++) total.speedBins[b] += result.speedBins[b];
+        total.overCap += result.overCap;
+        total.millis = max(total.millis, result.millis);
+        if (result.firstFailure >= 0 &&
+            (total.firstFailure < 0 || result.firstFailure < total.firstFailure)) {
+            total.firstFailure = result.firstFailure;
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    double elapsed = hostMillis() - start;
+
+    printf("pinball_fuzz: %d runs on %d workers, %llu ball-steps in %.0f ms, "
+           "%.0f ball-steps/s (slowest worker %.0f ms)\n",
+           fuzzRuns, workers, (unsigned long long)total.ballSteps, elapsed,
+           total.ballSteps * 1000.0 / elapsed, total.millis);
+    printf("pinball_fuzz: %u non-finite, %u tunneling, %u passive energy gains (worst %.2f)\n",
+           total.nonFinite, total.tunnels, total.energyGains, total.worstGain);
+    printf("pinball_fuzz: peak speed %.1f px/tick; runs by peak:", total.peakSpeed);
+    for (int b = 0; b < SPEED_BINS; b++) {
+        printf(" %s%d:%u", b == SPEED_BINS - 1 ? ">=" : "<", (b + (b < SPEED_BINS - 1)) * FUZZ_BIN,
+               total.speedBins[b]);
+    }
+    printf("\npinball_fuzz: %u runs (%.1f%%) past MAX_BALL_SPEED %.0f, %u past FUZZ_SPEED_LIMIT %.0f\n",
+           total.overCap, 100.0 * total.overCap / fuzzRuns, MAX_BALL_SPEED, total.overLimit,
+           FUZZ_SPEED_LIMIT);
+
+    if (lost) {
+        printf("pinball_fuzz: a worker died\n");
+        return 1;
+    }
+    if (total.firstFailure >= 0) {
+        printf("pinball_fuzz: FAILED, first at run %d\n", total.firstFailure);
+        return 1;
+    }
+    printf("pinball_fuzz: ok\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+// The hand-written circle span tables in raster.cpp have to say what
+// circleHalfWidth computes for radii without one.
+
+#include "check.h"
+#include "engine/raster.h"
+#include <math.h>
+
+#define MAX_TABLE_RADIUS 64
+
+int main() {
+    int tables = 0;
+    for (int r = 0; r <= MAX_TABLE_RADIUS; r++) {
+        const uint8_t *table = circleSpanTable(r);
+        if (!table) continue;
+        tables++;
+        for (int dy = 0; dy <= r; dy++) {
+            int want = (int)floor(sqrt((double)(r * r - dy * dy + r)));
+            if (table[dy] != want) {
+                printf("raster_test: radius %d row %d is %d, want %d\n", r, dy, table[dy], want);
+                checkFailures++;
+            }
+            CHECK(circleHalfWidth(r, dy) == table[dy] && circleHalfWidth(r, -dy) == table[dy]);
+        }
+        CHECK(circleHalfWidth(r, r + 1) == -1);
+    }
+    CHECK(tables > 0);
+    return checkResult("raster_test");
+}
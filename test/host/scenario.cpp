@@ -0,0 +1,152 @@
+#include "scenario.h"
+#include "engine/lcd_batch.h"
+#include "games/game1_platform.h"
+#include "games/game2_pinball.h"
+#include "games/game3_skyroads.h"
+#include "games/game4_tetris.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+// Long enough on each title for its warm-up and timeout, then a spread of
+// everything the game draws
+static const ScenarioStep PLATFORM_STEPS[] = {
+    {80, 0},
+    {40, PRESS_RIGHT},
+    {2, PRESS_RIGHT | PRESS_A},
+    {30, PRESS_RIGHT | PRESS_B},
+    {10, 0},
+    {2, PRESS_UP},
+    {40, PRESS_LEFT},
+    {20, 0},
+};
+
+static const ScenarioStep PINBALL_STEPS[] = {
+    {100, 0},
+    {2, PRESS_B},
+    {40, 0},
+    {6, PRESS_LEFT},
+    {20, 0},
+    {6, PRESS_RIGHT},
+    {30, PRESS_LEFT | PRESS_RIGHT},
+    {60, 0},
+};
+
+static const ScenarioStep SKYROADS_STEPS[] = {
+    {130, 0},
+    {40, PRESS_UP},
+    {2, PRESS_LEFT},
+    {30, PRESS_UP},
+    {2, PRESS_A},
+    {30, 0},
+    {2, PRESS_START},
+    {40, PRESS_UP},
+    {2, PRESS_RIGHT},
+    {30, 0},
+};
+
+static const ScenarioStep TETRIS_STEPS[] = {
+    {80, 0},
+    {3, PRESS_LEFT},
+    {10, 0},
+    {2, PRESS_A},
+    {10, 0},
+    {2, PRESS_DOWN},
+    {10, 0},
+    {20, PRESS_RIGHT},
+    {20, PRESS_B},
+    {2, PRESS_UP},
+    {10, 0},
+    {2, PRESS_START},
+    {120, 0},
+};
+
+#define STEPS(steps) steps, sizeof(steps) / sizeof(steps[0])
+
+const Scenario SCENARIOS[SCENARIO_GAMES] = {
+    {"Platform", STEPS(PLATFORM_STEPS), GAME1_FRAME_MS},
+    {"Pinball", STEPS(PINBALL_STEPS), GAME2_FRAME_MS},
+    {"Skyroads", STEPS(SKYROADS_STEPS), GAME3_FRAME_MS},
+    {"Tetris", STEPS(TETRIS_STEPS), GAME4_FRAME_MS},
+};
+
+void runPass(uint8_t pressed) {
+    hostSetFaces(~pressed);
+    loop();
+}
+
+static const char *card = NULL;
+
+void setScenarioCard(const char *dir) {
+    card = dir;
+}
+
+void bootToGame(int game) {
+    hostSetSDRoot(card);
+    setup();
+    runPass(PRESS_A);          // Past the splash
+    runPass(0);
+    for (int i = 0; i < game; i++) {
+        runPass(PRESS_DOWN);
+        runPass(0);
+    }
+    runPass(PRESS_A);
+}
+
+void playScenario(int game, void (*afterPass)(int pass, void *context), void *context) {
+    bootToGame(game);
+    resetHostBusStats();
+    const Scenario &scenario = SCENARIOS[game];
+    int pass = 0;
+    for (int i = 0; i < scenario.stepCount; i++) {
+        for (int n = 0; n < scenario.steps[i].passes; n++) {
+            runPass(scenario.steps[i].pressed);
+            afterPass(pass++, context);
+        }
+    }
+}
+
+uint32_t busMicros(const HostBusStats &counts) {
+    return counts.bytes * 8 * 1000000 / LCD_SPI_HZ + counts.transactions * LCD_TRANSACTION_US +
+           counts.windows * LCD_WINDOW_US + counts.pushes * LCD_PUSH_US +
+           counts.sdBytes * 8 * 1000000 / SD_SPI_HZ;
+}
+
+void measureBusPass(int, void *context) {
+    BusTotals &totals = *(BusTotals *)context;
+    const HostBusStats &bus = hostBusStats();
+    uint32_t micros = busMicros(bus);
+    totals.micros += micros;
+    totals.peak = max(totals.peak, micros);
+    totals.passes++;
+    if (micros > totals.budgetMicros) totals.overBudget++;
+    totals.sum.transactions += bus.transactions;
+    totals.sum.windows += bus.windows;
+    totals.sum.pushes += bus.pushes;
+    totals.sum.pixels += bus.pixels;
+    totals.sum.bytes += bus.bytes;
+    totals.sum.sdBytes += bus.sdBytes;
+    resetHostBusStats();
+}
+
+int forEachGame(int (*test)(int game)) {
+    int failed = 0;
+    for (int game = 0; game < SCENARIO_GAMES; game++) {
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            int code = test(game);
+            fflush(stdout);
+            _exit(code);
+        }
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("%s: FAILED\n", SCENARIOS[game].name);
+            failed++;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,74 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "shim/host.h"
+
+// Drives the whole firmware, menu and all, the way a player would: boot,
+// step down the menu to a game, then hold the buttons each game's script
+// says, one loop() pass at a time. Every game is run in a process of its
+// own, since a game keeps file statics from one play to the next.
+
+#define SCENARIO_GAMES 4
+#define SD_SPI_HZ 40000000     // As M5.begin starts the card
+
+// Faces buttons, set for pressed (host.h takes them inverted)
+#define PRESS_UP 0x01
+#define PRESS_DOWN 0x02
+#define PRESS_LEFT 0x04
+#define PRESS_RIGHT 0x08
+#define PRESS_A 0x10
+#define PRESS_B 0x20
+#define PRESS_SELECT 0x40
+#define PRESS_START 0x80
+
+struct ScenarioStep {
+    uint16_t passes;
+    uint8_t pressed;           // Held for all of them
+};
+
+struct Scenario {
+    const char *name;          // As the menu lists it
+    const ScenarioStep *steps;
+    int stepCount;
+    int frameMs;               // The game's frame budget
+};
+
+extern const Scenario SCENARIOS[SCENARIO_GAMES];
+
+// One pass of the firmware's loop with the given buttons held
+void runPass(uint8_t pressed);
+
+// Boot to the menu and start the game, ready for its first pass
+void bootToGame(int game);
+
+// Directory bootToGame gives the firmware as its SD card, NULL (the
+// default) for none
+void setScenarioCard(const char *dir);
+
+// Play the game's script from the start, calling afterPass after each
+// pass. Bus counts are reset once the game has been started.
+void playScenario(int game, void (*afterPass)(int pass, void *context), void *context);
+
+// Bus time for the counts, priced as lcd_batch prices its own, with SD
+// transfers at the card's clock
+uint32_t busMicros(const HostBusStats &counts);
+
+// Bus time per pass over a script, everything on the bus counted, direct
+// draws included. Start from zero with the budget set, and pass
+// measureBusPass to playScenario.
+struct BusTotals {
+    uint64_t micros;
+    uint32_t peak;
+    uint32_t budgetMicros;
+    int passes;
+    int overBudget;            // Passes whose bus time alone passed the budget
+    HostBusStats sum;
+};
+
+void measureBusPass(int pass, void *totals);
+
+// Runs test(game) for every game, each in a child process, and returns
+// how many failed
+int forEachGame(int (*test)(int game));
+
+#endif
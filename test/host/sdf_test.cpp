@@ -0,0 +1,180 @@
+// Pinball table SDF against the exact distance to the nearest primitive,
+// on a table of thin segments, a narrow V and an arc, where blending the
+// corners' normals used to cancel or flip them. Then balls stepped into
+// that table both ways collideStatic can resolve them, SDF and analytic,
+// have to come out of each contact the same.
+
+#include "check.h"
+#include "shim/host.h"
+#include "games/game2_pinball_sdf.h"
+
+#define BALL_RADIUS 4          // As game2_pinball.cpp has it
+#define CONTACT_DIST 6.0       // Out past the radius, where contacts are decided
+#define STEP 0.25
+#define SUBSTEP_DIST (BALL_RADIUS / 2.0)  // As well
+#define SHOTS 20000
+#define SHOT_STEPS 400         // Sub-steps a shot is followed for
+#define CONTACT_TOLERANCE 0.01 // Position and velocity, px and px/tick
+
+static PinballTable table;
+static TableSDF sdf;
+
+// Exact nearest over every primitive
+static float nearestPrim(float x, float y) {
+    float best = TABLE_FAR;
+    for (int i = 0; i < table.primCount; i++) {
+        float nx, ny;
+        best = min(best, tablePrimDistance(table.prims[i], x, y, nx, ny));
+    }
+    return best;
+}
+
+static void checkNearSurfaces() {
+    int samples = 0;
+    int wrongDist = 0, wrongNormal = 0, missed = 0;
+    float worst = 0;
+
+    // Inside the walls, where a ball can be
+    for (float y = 25; y < SDF_ROWS * SDF_CELL - SDF_CELL; y += STEP) {
+        for (float x = 5; x < 315; x += STEP) {
+            float exact = nearestPrim(x, y);
+            SDFSample sample;
+            if (!sampleTableSDF(sdf, table, x, y, sample)) continue;
+
+            // Far away the blend only has to stay far
+            if (exact >= CONTACT_DIST) {
+                if (sample.dist < BALL_RADIUS) missed++;
+                continue;
+            }
+            samples++;
+            float error = fabs(sample.dist - exact);
+            worst = max(worst, error);
+            if (error > 0.001) wrongDist++;
+
+            // The normal is the chosen primitive's own at this point
+            float nx, ny;
+            tablePrimDistance(table.prims[sample.prim], x, y, nx, ny);
+            if (nx * sample.nx + ny * sample.ny < 0.999) wrongNormal++;
+        }
+    }
+
+    if (wrongDist || wrongNormal || missed) {
+        printf("sdf_test: of %d near samples %d have the wrong distance (worst %.3f) and "
+               "%d the wrong normal; %d far samples read near\n",
+               samples, wrongDist, worst, wrongNormal, missed);
+    }
+    CHECK(samples > 10000);
+    CHECK(wrongDist == 0);
+    CHECK(wrongNormal == 0);
+    CHECK(missed == 0);
+}
+
+// collideStatic with TABLE_SDF 1: the nearest primitive, from the field
+static void resolveSDF(float &x, float &y, float &vx, float &vy) {
+    SDFSample sample;
+    if (!sampleTableSDF(sdf, table, x, y, sample) || sample.dist >= BALL_RADIUS) return;
+    bounceOffTablePrim(table.prims[sample.prim], sample.nx, sample.ny,
+                       BALL_RADIUS - sample.dist, x, y, vx, vy);
+}
+
+// collideStatic with TABLE_SDF 0: every primitive the BVH finds near it.
+// Returns how many it bounced off.
+static int resolveAnalytic(float &x, float &y, float &vx, float &vy) {
+    uint8_t nearby[MAX_TABLE_PRIMS];
+    int hits = queryTable(table, x - BALL_RADIUS - 1, y - BALL_RADIUS - 1,
+                          x + BALL_RADIUS + 1, y + BALL_RADIUS + 1, nearby, MAX_TABLE_PRIMS);
+    int bounced = 0;
+    for (int h = 0; h < hits; h++) {
+        bounced += collideTablePrim(table.prims[nearby[h]], BALL_RADIUS, x, y, vx, vy);
+    }
+    return bounced;
+}
+
+// Primitives closer to the ball's centre than reach
+static int touching(float x, float y, float reach) {
+    int count = 0;
+    for (int i = 0; i < table.primCount; i++) {
+        float nx, ny;
+        count += tablePrimDistance(table.prims[i], x, y, nx, ny) < reach;
+    }
+    return count;
+}
+
+// Shots from open spots, moved in sub-steps as updateBalls moves them.
+// Each contact is resolved both ways from the same state, and the shot
+// carries on from the analytic result so differences don't compound.
+// Where the ball touches two primitives at once, in a corner or pushed
+// from one into the other, the SDF resolves only the nearer and leaves
+// the other to the next sub-step. There it need only not push the ball
+// deeper in, nor speed it up.
+static void checkContacts() {
+    int contacts = 0, corners = 0, differ = 0, cornersWrong = 0;
+    float worst = 0;
+    randomSeed(2024);
+    for (int shot = 0; shot < SHOTS; shot++) {
+        float x, y;
+        do {
+            x = random(10, 310);
+            y = random(30, SDF_ROWS * SDF_CELL - SDF_CELL);
+        } while (nearestPrim(x, y) < 2 * BALL_RADIUS);
+        float angle = random(0, 3600) * PI / 1800;
+        float speed = random(50, 2000) / 100.0;
+        float vx = speed * cos(angle), vy = speed * sin(angle);
+
+        for (int step = 0; step < SHOT_STEPS; step++) {
+            int steps = 1 + (int)(sqrt(vx * vx + vy * vy) / SUBSTEP_DIST);
+            x += vx / steps;
+            y += vy / steps;
+            if (x < 0 || x >= 320 || y < 0 || y >= SDF_ROWS * SDF_CELL - SDF_CELL) break;
+
+            float depth = nearestPrim(x, y);
+            int overlaps = touching(x, y, BALL_RADIUS);
+            float speedIn = sqrt(vx * vx + vy * vy);
+            float sx = x, sy = y, svx = vx, svy = vy;
+            resolveSDF(sx, sy, svx, svy);
+            int hits = resolveAnalytic(x, y, vx, vy);
+            if (hits == 0 && sx == x && sy == y && svx == vx && svy == vy) continue;
+
+            if (overlaps > 1 || hits > 1 || touching(sx, sy, BALL_RADIUS - CONTACT_TOLERANCE) > 0) {
+                corners++;
+                if (nearestPrim(sx, sy) < depth ||
+                    sqrt(svx * svx + svy * svy) > speedIn + CONTACT_TOLERANCE) {
+                    cornersWrong++;
+                }
+                continue;
+            }
+            contacts++;
+            float error = max(max(fabs(sx - x), fabs(sy - y)), max(fabs(svx - vx), fabs(svy - vy)));
+            worst = max(worst, error);
+            if (error > CONTACT_TOLERANCE) differ++;
+        }
+    }
+
+    if (differ || cornersWrong) {
+        printf("sdf_test: of %d contacts %d come out different (worst %.3f); "
+               "%d of %d corner contacts go wrong\n",
+               contacts, differ, worst, cornersWrong, corners);
+    }
+    CHECK(contacts > 10000);
+    CHECK(corners > 0);
+    CHECK(differ == 0);
+    CHECK(cornersWrong == 0);
+}
+
+int main() {
+    parseTable(table, "wall 5 240 5 25\n"
+                      "wall 5 25 315 25\n"
+                      "wall 315 25 315 240\n"
+                      "seg 40 60 150 95 RED\n"
+                      "seg 60 140 61 210 CYAN\n"
+                      "seg 200 60 240 140 ORANGE\n"     // Narrow V
+                      "seg 200 60 215 140 ORANGE\n"
+                      "arc 160 170 30 20 160 GREEN\n"
+                      "arc 260 190 18 200 340 GREEN\n"
+                      "bumper 120 120 10 RED 100\n");
+    CHECK(table.primCount == 10);
+    buildTableSDF(sdf, table);
+    checkNearSurfaces();
+    checkContacts();
+    return checkResult("sdf_test");
+}
@@ -0,0 +1,50 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+// A handle, as on the device: copies share the open file
+class File {
+   public:
+    File() {}
+    explicit File(FILE *f);
+
+    operator bool() const { return handle && handle->f; }
+    size_t write(const uint8_t *data, size_t len);
+    size_t read(uint8_t *data, size_t len);
+    int read();
+    int available();
+    size_t size();
+    void close();
+
+   private:
+    struct Handle {
+        FILE *f;
+        ~Handle();
+    };
+    std::shared_ptr<Handle> handle;
+};
+
+// Paths are relative to the directory host.h's hostSetSDRoot gave, or
+// nothing opens when no card is in
+class FS {
+   public:
+    File open(const char *path, const char *mode = FILE_READ);
+    bool exists(const char *path);
+    bool mkdir(const char *path);
+    bool remove(const char *path);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif
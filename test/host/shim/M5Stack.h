@@ -0,0 +1,157 @@
+#ifndef HOST_M5STACK_H
+#define HOST_M5STACK_H
+
+// M5Stack for the host build. The panel is a 320x240 framebuffer behind a
+// model of the SPI bus as In_eSPI drives it on the Core: CS is taken by
+// spi_begin, and dropped by spi_end unless a startWrite transaction is
+// open. Shape and text calls open and close their own transaction the
+// way In_eSPI's do, so they end one the caller started too. An address
+// window sent with CS high never reaches the panel, and the pixels after
+// it land wherever the panel's write pointer was.
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <FS.h>
+#include <SD.h>
+#include <pgmspace.h>
+#include <Fonts/glcdfont.c>
+
+#define SPI_FREQUENCY 20000000         // As In_eSPI.h sets it for the Core
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_DARKCYAN 0x03EF
+#define TFT_MAROON 0x7800
+#define TFT_PURPLE 0x780F
+#define TFT_OLIVE 0x7BE0
+#define TFT_LIGHTGREY 0xC618
+#define TFT_DARKGREY 0x7BEF
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+#define TFT_ORANGE 0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_PINK 0xFC9F
+
+class TFT_eSPI {
+   public:
+    void startWrite();
+    void endWrite();
+    void setWindow(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+    void pushColors(uint16_t *data, uint32_t len, bool swap = true);
+    void readRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data);
+
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color);
+    void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color);
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void fillScreen(uint32_t color);
+    void fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color);
+    void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+
+    void setCursor(int16_t x, int16_t y);
+    void setTextSize(uint8_t size);
+    void setTextColor(uint16_t color);
+    void setTextColor(uint16_t color, uint16_t bg);
+
+    size_t write(uint8_t c);
+    size_t print(const char *text);
+    size_t print(char c);
+    size_t print(int value);
+    size_t print(unsigned value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value, int digits = 2);
+    template <typename T>
+    size_t println(T value) {
+        size_t n = print(value);
+        return n + print("\r\n");
+    }
+    size_t println() { return print("\r\n"); }
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    int16_t width() const { return 320; }
+    int16_t height() const { return 240; }
+
+   private:
+    void spiBegin();
+    void spiEnd();
+    void writePixels(uint16_t color, uint32_t count);
+
+    bool csLow = false;
+    bool inTransaction = false;
+    int32_t cursorX = 0, cursorY = 0;
+    uint8_t textSize = 1;
+    uint16_t textColor = TFT_WHITE, textBg = TFT_BLACK;
+};
+
+class M5Display : public TFT_eSPI {};
+
+// Only what font_cache needs: a 16-bit cell to draw one glyph into
+class TFT_eSprite {
+   public:
+    explicit TFT_eSprite(TFT_eSPI *) {}
+    ~TFT_eSprite() { deleteSprite(); }
+    void setColorDepth(int8_t) {}
+    void *createSprite(int16_t w, int16_t h);
+    void deleteSprite();
+    void fillSprite(uint32_t color);
+    void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+    uint16_t readPixel(int32_t x, int32_t y);
+
+   private:
+    uint16_t *pixels = nullptr;
+    int16_t width = 0, height = 0;
+};
+
+// Pressed is whatever host.h's hostSetButtons last said; edges are taken
+// in M5.update(), as on the device
+class Button {
+   public:
+    uint8_t isPressed() { return pressed; }
+    uint8_t wasPressed() { return pressed && changed; }
+    uint8_t wasReleased() { return !pressed && changed; }
+    uint8_t pressedFor(uint32_t ms) { return pressed && millis() - since >= ms; }
+    void update(bool now);
+
+   private:
+    bool pressed = false;
+    bool changed = false;
+    uint32_t since = 0;
+};
+
+class POWER {
+   public:
+    bool begin() { return true; }
+    int8_t getBatteryLevel() { return 100; }
+    bool isCharging() { return false; }
+    void deepSleep(uint64_t = 0);
+};
+
+class SPEAKER {
+   public:
+    void mute() {}
+    void end() {}
+};
+
+class M5Stack {
+   public:
+    void begin(bool lcd = true, bool sd = true, bool serial = true, bool i2c = false);
+    void update();
+
+    M5Display Lcd;
+    Button BtnA, BtnB, BtnC;
+    POWER Power;
+    SPEAKER Speaker;
+};
+
+extern M5Stack M5;
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include "FS.h"
+
+class SDFS : public fs::FS {};
+
+extern SDFS SD;
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+// The Faces pad is the only I2C device the games talk to; reads return
+// whatever host.h's hostSetFaces last set.
+class TwoWire {
+   public:
+    void begin() {}
+    uint8_t requestFrom(int address, int count);
+    int available();
+    int read();
+
+   private:
+    int pending = 0;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,315 @@
+#include "host.h"
+#include <SD.h>
+#include <Wire.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+TwoWire Wire;
+SDFS SD;
+
+static uint32_t now;               // Virtual milliseconds
+static uint64_t randomState = 1;
+static uint8_t faces = 0xFF;
+static bool buttons[3];
+static std::string sdRoot;
+static bool sdInserted = false;
+static FILE *serialOut = NULL;
+static bool asleep = false;
+
+// Tasks. Exactly one thread runs at a time: whichever `running` names, or
+// the loop when it is NULL. A task is handed the baton by the loop's
+// delay() when it is due and hands it back when it blocks.
+#define NEVER UINT64_MAX
+
+struct HostTask {
+    TaskFunction_t code;
+    void *param;
+    uint64_t due;              // Virtual ms it next wants to run, or NEVER
+    uint32_t notified;
+    bool dead;
+};
+
+struct HostTaskExit {};
+
+// Leaked on purpose: detached task threads may still be parked on these
+// when the process exits
+static std::mutex &batonLock = *new std::mutex;
+static std::condition_variable &batonMoved = *new std::condition_variable;
+static HostTask *running = NULL;
+static std::vector<HostTask *> tasks;
+static thread_local HostTask *self = NULL;
+
+static void passBaton(HostTask *to) {
+    std::unique_lock<std::mutex> lock(batonLock);
+    running = to;
+    batonMoved.notify_all();
+    batonMoved.wait(lock, [] { return running == self; });
+}
+
+static void taskMain(HostTask *task) {
+    self = task;
+    {
+        std::unique_lock<std::mutex> lock(batonLock);
+        batonMoved.wait(lock, [task] { return running == task; });
+    }
+    try {
+        task->code(task->param);
+    } catch (HostTaskExit &) {
+    }
+    std::unique_lock<std::mutex> lock(batonLock);
+    task->dead = true;
+    running = NULL;
+    batonMoved.notify_all();
+}
+
+// Run whatever falls due up to `until`, in order of when it is due
+static void runTasks(uint64_t until) {
+    for (;;) {
+        HostTask *next = NULL;
+        for (HostTask *task : tasks) {
+            if (!task->dead && task->due <= until && (!next || task->due < next->due)) {
+                next = task;
+            }
+        }
+        if (!next) break;
+        if (next->due > now) now = next->due;
+        passBaton(next);
+    }
+}
+
+// Block the calling task until `due`, letting the loop carry on
+static void block(uint64_t due) {
+    self->due = due;
+    passBaton(NULL);
+}
+
+uint32_t millis() {
+    return now;
+}
+
+uint32_t micros() {
+    return now * 1000;
+}
+
+void delay(uint32_t ms) {
+    if (self) {
+        block((uint64_t)now + ms);
+        return;
+    }
+    uint64_t until = (uint64_t)now + ms;
+    runTasks(until);
+    now = until;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *, uint32_t, void *param,
+                                   UBaseType_t, TaskHandle_t *handle, BaseType_t) {
+    HostTask *task = new HostTask{code, param, now, 0, false};
+    tasks.push_back(task);
+    if (handle) *handle = task;
+    std::thread(taskMain, task).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == self) throw HostTaskExit();
+    ((HostTask *)task)->dead = true;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t period) {
+    *previousWake += period;
+    block(*previousWake);
+}
+
+TickType_t xTaskGetTickCount() {
+    return now;
+}
+
+void xTaskNotifyGive(TaskHandle_t handle) {
+    HostTask *task = (HostTask *)handle;
+    task->notified++;
+    if (task->due == NEVER) task->due = now;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+    if (self->notified == 0) block(wait == portMAX_DELAY ? NEVER : (uint64_t)now + wait);
+    uint32_t count = self->notified;
+    if (count > 0) self->notified = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+// A 64-bit LCG, so a seed gives the same game everywhere
+void randomSeed(unsigned long seed) {
+    if (seed != 0) randomState = seed;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    randomState = randomState * 6364136223846793005ull + 1442695040888963407ull;
+    return (long)((randomState >> 33) % (uint64_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+int analogRead(uint8_t) {
+    return 0;
+}
+
+int HardwareSerial::printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = serialOut ? vfprintf(serialOut, format, args) : 0;
+    va_end(args);
+    return n;
+}
+
+size_t HardwareSerial::print(const char *text) {
+    return serialOut ? fputs(text, serialOut) : 0;
+}
+
+size_t HardwareSerial::println(const char *text) {
+    return print(text) + print("\r\n");
+}
+
+uint8_t TwoWire::requestFrom(int, int count) {
+    pending = count;
+    return count;
+}
+
+int TwoWire::available() {
+    return pending;
+}
+
+int TwoWire::read() {
+    if (pending == 0) return -1;
+    pending--;
+    return faces;
+}
+
+void Button::update(bool now) {
+    changed = now != pressed;
+    if (changed) since = millis();
+    pressed = now;
+}
+
+void POWER::deepSleep(uint64_t) {
+    asleep = true;
+}
+
+void M5Stack::begin(bool, bool, bool, bool) {
+    Lcd.fillScreen(TFT_BLACK);
+    Lcd.setCursor(0, 0);
+}
+
+void M5Stack::update() {
+    BtnA.update(buttons[0]);
+    BtnB.update(buttons[1]);
+    BtnC.update(buttons[2]);
+}
+
+// In lcd.cpp, with the panel's share of the bus
+void hostCountSD(size_t bytes);
+
+namespace fs {
+
+File::File(FILE *f) : handle(new Handle{f}) {}
+
+File::Handle::~Handle() {
+    if (f) fclose(f);
+}
+
+size_t File::write(const uint8_t *data, size_t len) {
+    if (!*this) return 0;
+    hostCountSD(len);
+    return fwrite(data, 1, len, handle->f);
+}
+
+size_t File::read(uint8_t *data, size_t len) {
+    if (!*this) return 0;
+    hostCountSD(len);
+    return fread(data, 1, len, handle->f);
+}
+
+int File::read() {
+    return *this ? fgetc(handle->f) : -1;
+}
+
+int File::available() {
+    if (!*this) return 0;
+    long at = ftell(handle->f);
+    return (int)(size() - at);
+}
+
+size_t File::size() {
+    if (!*this) return 0;
+    long at = ftell(handle->f);
+    fseek(handle->f, 0, SEEK_END);
+    long end = ftell(handle->f);
+    fseek(handle->f, at, SEEK_SET);
+    return end;
+}
+
+void File::close() {
+    if (!*this) return;
+    fclose(handle->f);
+    handle->f = NULL;
+}
+
+static std::string cardPath(const char *path) {
+    return sdRoot + "/" + path;
+}
+
+File FS::open(const char *path, const char *mode) {
+    if (!sdInserted) return File();
+    FILE *f = fopen(cardPath(path).c_str(), strcmp(mode, FILE_READ) == 0 ? "rb" : mode);
+    return f ? File(f) : File();
+}
+
+bool FS::exists(const char *path) {
+    struct stat info;
+    return sdInserted && stat(cardPath(path).c_str(), &info) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+    return sdInserted && ::mkdir(cardPath(path).c_str(), 0777) == 0;
+}
+
+bool FS::remove(const char *path) {
+    return sdInserted && ::remove(cardPath(path).c_str()) == 0;
+}
+
+}  // namespace fs
+
+void hostSetFaces(uint8_t bits) {
+    faces = bits;
+}
+
+void hostSetButtons(bool a, bool b, bool c) {
+    buttons[0] = a;
+    buttons[1] = b;
+    buttons[2] = c;
+}
+
+void hostSetSDRoot(const char *dir) {
+    sdInserted = dir != NULL;
+    sdRoot = dir ? dir : "";
+}
+
+void hostSetSerial(FILE *out) {
+    serialOut = out;
+}
+
+bool hostAsleep() {
+    return asleep;
+}
@@ -0,0 +1,48 @@
+#ifndef HOST_H
+#define HOST_H
+
+// What the host tests see of the shim: the panel's pixels, what crossed
+// the bus to draw them, and the inputs.
+
+#include <M5Stack.h>
+
+#define HOST_LCD_WIDTH 320
+#define HOST_LCD_HEIGHT 240
+
+// Counted as In_eSPI would drive the bus. bytes is what goes over the
+// wire: 11 per address window (CASET and PASET with 4 data bytes each,
+// then RAMWR) and 2 per pixel, or 3 per pixel and a dummy byte read back.
+// The SD card is on the same bus; its transfers count as transactions,
+// and their bytes on their own.
+struct HostBusStats {
+    uint32_t transactions;     // Times CS was taken
+    uint32_t windows;
+    uint32_t pushes;           // Pixel blocks: one per pushColors or fill
+    uint32_t pixels;
+    uint64_t bytes;
+    uint32_t unheld;           // Windows sent with CS high, lost on hardware
+    uint64_t sdBytes;          // Read from or written to the card
+};
+
+// The panel, RGB565, row by row
+const uint16_t *hostScreen();
+uint64_t hostScreenHash();
+bool hostWritePPM(const char *path);
+
+const HostBusStats &hostBusStats();
+void resetHostBusStats();
+
+// Pressed is a 0 bit, as the Faces pad sends it
+void hostSetFaces(uint8_t bits);
+void hostSetButtons(bool a, bool b, bool c);
+
+// Directory standing in for the SD card, NULL for no card
+void hostSetSDRoot(const char *dir);
+
+// Where Serial goes, NULL (the default) to drop it
+void hostSetSerial(FILE *out);
+
+// Set when the game puts the device to sleep
+bool hostAsleep();
+
+#endif
@@ -0,0 +1,429 @@
+#include "host.h"
+
+static uint16_t screen[HOST_LCD_HEIGHT][HOST_LCD_WIDTH];
+static HostBusStats bus;
+
+// The panel's address window and write pointer
+static int32_t windowX0, windowX1 = HOST_LCD_WIDTH - 1, windowY0, windowY1 = HOST_LCD_HEIGHT - 1;
+static int32_t pointerX, pointerY;
+
+M5Stack M5;
+
+void TFT_eSPI::spiBegin() {
+    if (csLow) return;
+    csLow = true;
+    bus.transactions++;
+}
+
+void TFT_eSPI::spiEnd() {
+    if (!inTransaction) csLow = false;
+}
+
+void TFT_eSPI::startWrite() {
+    spiBegin();
+    inTransaction = true;
+}
+
+void TFT_eSPI::endWrite() {
+    inTransaction = false;
+    spiEnd();
+}
+
+void TFT_eSPI::setWindow(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+    bus.windows++;
+    bus.bytes += 11;
+    if (!csLow) {
+        bus.unheld++;
+        return;
+    }
+    windowX0 = pointerX = x0;
+    windowY0 = pointerY = y0;
+    windowX1 = x1;
+    windowY1 = y1;
+}
+
+// Pixels into the window, wrapping at its edges as the panel does. Off the
+// panel they are lost but still move the pointer.
+void TFT_eSPI::writePixels(uint16_t color, uint32_t count) {
+    bus.pixels += count;
+    bus.bytes += count * 2;
+    if (!csLow) return;
+    while (count--) {
+        if (pointerX >= 0 && pointerX < HOST_LCD_WIDTH && pointerY >= 0 &&
+            pointerY < HOST_LCD_HEIGHT) {
+            screen[pointerY][pointerX] = color;
+        }
+        if (++pointerX > windowX1) {
+            pointerX = windowX0;
+            if (++pointerY > windowY1) pointerY = windowY0;
+        }
+    }
+}
+
+void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap) {
+    spiBegin();
+    bus.pushes++;
+    // Unswapped, the bytes go out as they sit in memory, low byte first
+    for (uint32_t i = 0; i < len; i++) {
+        writePixels(swap ? data[i] : (uint16_t)((data[i] >> 8) | (data[i] << 8)), 1);
+    }
+    spiEnd();
+}
+
+// In pushImage byte order, as In_eSPI returns it. In_eSPI raises CS at
+// the end even inside a transaction, so callers end theirs first.
+void TFT_eSPI::readRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data) {
+    spiBegin();
+    bus.windows++;
+    bus.bytes += 11 + 1 + (uint64_t)w * h * 3;
+    spiEnd();
+    for (int32_t row = 0; row < h; row++) {
+        for (int32_t col = 0; col < w; col++) {
+            uint16_t pixel = 0;
+            if (x + col >= 0 && x + col < HOST_LCD_WIDTH && y + row >= 0 &&
+                y + row < HOST_LCD_HEIGHT) {
+                pixel = screen[y + row][x + col];
+            }
+            *data++ = (pixel >> 8) | (pixel << 8);
+        }
+    }
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) {
+    if (x < 0 || y < 0 || x >= HOST_LCD_WIDTH || y >= HOST_LCD_HEIGHT) return;
+    spiBegin();
+    setWindow(x, y, x, y);
+    bus.pushes++;
+    writePixels(color, 1);
+    spiEnd();
+}
+
+void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+    if (y < 0 || x >= HOST_LCD_WIDTH || y >= HOST_LCD_HEIGHT) return;
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+    if (x + w > HOST_LCD_WIDTH) w = HOST_LCD_WIDTH - x;
+    if (w < 1) return;
+    spiBegin();
+    setWindow(x, y, x + w - 1, y);
+    bus.pushes++;
+    writePixels(color, w);
+    spiEnd();
+}
+
+void TFT_eSPI::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {
+    if (x < 0 || x >= HOST_LCD_WIDTH || y >= HOST_LCD_HEIGHT) return;
+    if (y < 0) {
+        h += y;
+        y = 0;
+    }
+    if (y + h > HOST_LCD_HEIGHT) h = HOST_LCD_HEIGHT - y;
+    if (h < 1) return;
+    spiBegin();
+    setWindow(x, y, x, y + h - 1);
+    bus.pushes++;
+    writePixels(color, h);
+    spiEnd();
+}
+
+// In_eSPI's ESP32 Bresenham, in horizontal or vertical runs
+void TFT_eSPI::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) {
+    inTransaction = true;
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    int32_t dx = x1 - x0, dy = abs(y1 - y0);
+    int32_t err = dx >> 1, ystep = y0 < y1 ? 1 : -1, xs = x0, dlen = 0;
+    for (; x0 <= x1; x0++) {
+        dlen++;
+        err -= dy;
+        if (err < 0) {
+            err += dx;
+            if (steep) {
+                if (dlen == 1) drawPixel(y0, xs, color);
+                else drawFastVLine(y0, xs, dlen, color);
+            } else {
+                if (dlen == 1) drawPixel(xs, y0, color);
+                else drawFastHLine(xs, y0, dlen, color);
+            }
+            dlen = 0;
+            y0 += ystep;
+            xs = x0 + 1;
+        }
+    }
+    if (dlen) {
+        if (steep) drawFastVLine(y0, xs, dlen, color);
+        else drawFastHLine(xs, y0, dlen, color);
+    }
+    inTransaction = false;
+    spiEnd();
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    inTransaction = true;
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y + 1, h - 2, color);
+    drawFastVLine(x + w - 1, y + 1, h - 2, color);
+    inTransaction = false;
+    spiEnd();
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    if (x >= HOST_LCD_WIDTH || y >= HOST_LCD_HEIGHT) return;
+    if (x < 0) {
+        w += x;
+        x = 0;
+    }
+    if (y < 0) {
+        h += y;
+        y = 0;
+    }
+    if (x + w > HOST_LCD_WIDTH) w = HOST_LCD_WIDTH - x;
+    if (y + h > HOST_LCD_HEIGHT) h = HOST_LCD_HEIGHT - y;
+    if (w < 1 || h < 1) return;
+    spiBegin();
+    setWindow(x, y, x + w - 1, y + h - 1);
+    bus.pushes++;
+    writePixels(color, w * h);
+    spiEnd();
+}
+
+void TFT_eSPI::fillScreen(uint32_t color) {
+    fillRect(0, 0, HOST_LCD_WIDTH, HOST_LCD_HEIGHT, color);
+}
+
+void TFT_eSPI::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+    int32_t x = 0, dx = 1, dy = r + r, p = -(r >> 1);
+    inTransaction = true;
+    drawFastHLine(x0 - r, y0, dy + 1, color);
+    while (x < r) {
+        if (p >= 0) {
+            dy -= 2;
+            p -= dy;
+            r--;
+        }
+        dx += 2;
+        p += dx;
+        x++;
+        drawFastHLine(x0 - r, y0 + x, 2 * r + 1, color);
+        drawFastHLine(x0 - r, y0 - x, 2 * r + 1, color);
+        drawFastHLine(x0 - x, y0 + r, 2 * x + 1, color);
+        drawFastHLine(x0 - x, y0 - r, 2 * x + 1, color);
+    }
+    inTransaction = false;
+    spiEnd();
+}
+
+void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg,
+                        uint8_t size) {
+    if (x >= HOST_LCD_WIDTH || y >= HOST_LCD_HEIGHT || x + 6 * size - 1 < 0 ||
+        y + 8 * size - 1 < 0 || c < 32) {
+        return;
+    }
+    bool fillbg = bg != color;
+
+    if (size == 1 && fillbg) {
+        // One window, the glyph's 5 columns and a gap column row by row
+        uint8_t column[6];
+        for (int i = 0; i < 5; i++) column[i] = pgm_read_byte(font + c * 5 + i);
+        column[5] = 0;
+        spiBegin();
+        setWindow(x, y, x + 5, y + 8);
+        bus.pushes++;
+        for (int j = 0; j < 8; j++) {
+            for (int k = 0; k < 6; k++) writePixels(column[k] >> j & 1 ? color : bg, 1);
+        }
+        spiEnd();
+        return;
+    }
+
+    inTransaction = true;
+    for (int i = 0; i < 6; i++) {
+        uint8_t line = i == 5 ? 0 : pgm_read_byte(font + c * 5 + i);
+        for (int j = 0; j < 8; j++, line >>= 1) {
+            if (size == 1) {
+                if (line & 1) drawPixel(x + i, y + j, color);
+            } else if (line & 1) {
+                fillRect(x + i * size, y + j * size, size, size, color);
+            } else if (fillbg) {
+                fillRect(x + i * size, y + j * size, size, size, bg);
+            }
+        }
+    }
+    inTransaction = false;
+    spiEnd();
+}
+
+void TFT_eSPI::setCursor(int16_t x, int16_t y) {
+    cursorX = x;
+    cursorY = y;
+}
+
+void TFT_eSPI::setTextSize(uint8_t size) {
+    if (size > 7) size = 7;
+    textSize = size > 0 ? size : 1;
+}
+
+void TFT_eSPI::setTextColor(uint16_t color) {
+    textColor = textBg = color;
+}
+
+void TFT_eSPI::setTextColor(uint16_t color, uint16_t bg) {
+    textColor = color;
+    textBg = bg;
+}
+
+// Font 1 only, wrapping at the right edge
+size_t TFT_eSPI::write(uint8_t c) {
+    if (c == '\r') return 1;
+    if (c == '\n') {
+        cursorY += 8 * textSize;
+        cursorX = 0;
+        return 1;
+    }
+    if (c < 32) return 1;
+    if (cursorX + 6 * textSize > HOST_LCD_WIDTH) {
+        cursorY += 8 * textSize;
+        cursorX = 0;
+    }
+    drawChar(cursorX, cursorY, c, textColor, textBg, textSize);
+    cursorX += 6 * textSize;
+    return 1;
+}
+
+size_t TFT_eSPI::print(const char *text) {
+    size_t n = 0;
+    while (*text) n += write(*text++);
+    return n;
+}
+
+size_t TFT_eSPI::print(char c) {
+    return write(c);
+}
+
+size_t TFT_eSPI::print(int value) {
+    return print((long)value);
+}
+
+size_t TFT_eSPI::print(unsigned value) {
+    return print((unsigned long)value);
+}
+
+size_t TFT_eSPI::print(long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return print(text);
+}
+
+size_t TFT_eSPI::print(unsigned long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%lu", value);
+    return print(text);
+}
+
+size_t TFT_eSPI::print(double value, int digits) {
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return print(text);
+}
+
+int TFT_eSPI::printf(const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    print(text);
+    return n;
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h) {
+    deleteSprite();
+    pixels = new uint16_t[w * h]();
+    width = w;
+    height = h;
+    return pixels;
+}
+
+void TFT_eSprite::deleteSprite() {
+    delete[] pixels;
+    pixels = nullptr;
+}
+
+void TFT_eSprite::fillSprite(uint32_t color) {
+    for (int i = 0; i < width * height; i++) pixels[i] = color;
+}
+
+void TFT_eSprite::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg,
+                           uint8_t size) {
+    if (c < 32) return;
+    for (int i = 0; i < 6; i++) {
+        uint8_t line = i == 5 ? 0 : pgm_read_byte(font + c * 5 + i);
+        for (int j = 0; j < 8 * size; j++) {
+            bool on = line >> (j / size) & 1;
+            if (!on && bg == color) continue;
+            for (int k = 0; k < size; k++) {
+                int px = x + i * size + k, py = y + j;
+                if (px >= 0 && px < width && py >= 0 && py < height) {
+                    pixels[py * width + px] = on ? color : bg;
+                }
+            }
+        }
+    }
+}
+
+uint16_t TFT_eSprite::readPixel(int32_t x, int32_t y) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+    return pixels[y * width + x];
+}
+
+const uint16_t *hostScreen() {
+    return &screen[0][0];
+}
+
+// FNV-1a over the pixels
+uint64_t hostScreenHash() {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    const uint16_t *pixel = hostScreen();
+    for (int i = 0; i < HOST_LCD_WIDTH * HOST_LCD_HEIGHT; i++) {
+        hash = (hash ^ (pixel[i] & 0xFF)) * 0x100000001B3ull;
+        hash = (hash ^ (pixel[i] >> 8)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool hostWritePPM(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", HOST_LCD_WIDTH, HOST_LCD_HEIGHT);
+    const uint16_t *pixel = hostScreen();
+    for (int i = 0; i < HOST_LCD_WIDTH * HOST_LCD_HEIGHT; i++) {
+        uint8_t rgb[3] = {(uint8_t)(pixel[i] >> 8 & 0xF8), (uint8_t)(pixel[i] >> 3 & 0xFC),
+                          (uint8_t)(pixel[i] << 3 & 0xF8)};
+        fwrite(rgb, 1, 3, f);
+    }
+    return fclose(f) == 0;
+}
+
+const HostBusStats &hostBusStats() {
+    return bus;
+}
+
+void hostCountSD(size_t bytes) {
+    bus.transactions++;
+    bus.sdBytes += bytes;
+}
+
+void resetHostBusStats() {
+    memset(&bus, 0, sizeof(bus));
+}
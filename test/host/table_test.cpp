@@ -0,0 +1,59 @@
+// Pinball table files: what the parser keeps, and what loadTable does
+// with files it can't use.
+
+#include "check.h"
+#include "shim/host.h"
+#include "engine/arena.h"
+#include "games/game2_pinball_table.h"
+#include <string>
+#include <sys/stat.h>
+
+#define CARD "build/table_card"
+#define DEFAULT_PRIMS 8        // The built-in table's walls and bumpers
+
+static PinballTable table;
+
+static void writeTableFile(const std::string &text) {
+    mkdir(CARD, 0777);
+    mkdir(CARD "/pinball", 0777);
+    FILE *f = fopen(CARD TABLE_PATH, "w");
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+}
+
+static void checkZeroLengthSkipped() {
+    parseTable(table, "wall 5 240 5 240\n"
+                      "seg 100 100 100 100 RED\n"
+                      "seg 100 100 120 110 RED\n");
+    CHECK(table.primCount == 1);
+    CHECK(table.prims[0].type == PRIM_SEGMENT);
+    CHECK(table.prims[0].x2 == 120);
+}
+
+static void checkLoad() {
+    hostSetSDRoot(CARD);
+
+    writeTableFile("bumper 100 100 10 RED 50\n");
+    arenaReset();
+    loadTable(table);
+    CHECK(table.primCount == 1);
+
+    // Too big to read whole: the built-in table, not a truncated file
+    std::string big;
+    while (big.size() < 5000) big += "seg 10 50 60 80 CYAN\n";
+    writeTableFile(big);
+    arenaReset();
+    loadTable(table);
+    CHECK(table.primCount == DEFAULT_PRIMS);
+
+    hostSetSDRoot(NULL);
+    arenaReset();
+    loadTable(table);
+    CHECK(table.primCount == DEFAULT_PRIMS);
+}
+
+int main() {
+    checkZeroLengthSkipped();
+    checkLoad();
+    return checkResult("table_test");
+}
@@ -0,0 +1,119 @@
+// Tetris autoplayer search: the placements the walk finds, line clears
+// and hashing in applyPlacement, and the move findBestMove picks.
+
+#include "check.h"
+#include "shim/host.h"
+#include "games/game4_tetris_search.h"
+
+enum { PIECE_I, PIECE_O, PIECE_T, PIECE_S, PIECE_Z, PIECE_J, PIECE_L };
+
+static SearchContext ctx;
+
+static void clearBoard(SearchBoard &board) {
+    memset(board.rows, 0, sizeof(board.rows));
+    board.hash = 0;
+}
+
+// Distinct footprints on an empty board: flat rotations give one per x,
+// and pieces whose rotations repeat their cells only count them once
+static void checkEmptyBoard() {
+    static const int EXPECTED[7] = {17, 9, 34, 17, 17, 34, 34};
+    SearchBoard board;
+    clearBoard(board);
+    Placement out[MAX_PLACEMENTS];
+    for (int piece = 0; piece < 7; piece++) {
+        int count = generatePlacements(ctx, board, piece, out);
+        CHECK(count == EXPECTED[piece]);
+        for (int i = 0; i < count; i++) {
+            SearchBoard after = board;
+            applyPlacement(after, piece, out[i]);
+            int cells = 0;
+            for (int y = 0; y < SEARCH_HEIGHT; y++) cells += __builtin_popcount(after.rows[y]);
+            CHECK(cells == 4);
+            CHECK(after.rows[SEARCH_HEIGHT - 1] != 0);   // Rests on the floor
+        }
+    }
+}
+
+// A roof over columns 0-5 with a gap under it: an O can only get there by
+// dropping right of the roof and shifting in underneath
+static void checkTuck() {
+    uint8_t cells[SEARCH_HEIGHT][SEARCH_WIDTH] = {};
+    for (int x = 0; x < 6; x++) cells[SEARCH_HEIGHT - 3][x] = 1;
+    SearchBoard board;
+    loadSearchBoard(board, cells);
+
+    Placement out[MAX_PLACEMENTS];
+    int count = generatePlacements(ctx, board, PIECE_O, out);
+    bool tucked = false;
+    for (int i = 0; i < count; i++) {
+        // Shape column 1 is the O's left edge
+        tucked |= out[i].y == SEARCH_HEIGHT - 2 && out[i].x + 1 < 6;
+    }
+    CHECK(tucked);
+}
+
+static void checkSpawnBlocked() {
+    SearchBoard board;
+    clearBoard(board);
+    board.rows[1] = SEARCH_FULL_ROW & ~1;
+    Placement out[MAX_PLACEMENTS];
+    CHECK(generatePlacements(ctx, board, PIECE_T, out) == 0);
+}
+
+// Clearing moves every row, and the hash has to follow them
+static void checkLineClear() {
+    uint8_t cells[SEARCH_HEIGHT][SEARCH_WIDTH] = {};
+    for (int x = 0; x < SEARCH_WIDTH - 1; x++) {
+        cells[SEARCH_HEIGHT - 1][x] = 1;
+        cells[SEARCH_HEIGHT - 2][x] = 1;
+    }
+    cells[SEARCH_HEIGHT - 3][0] = 1;
+    SearchBoard board;
+    loadSearchBoard(board, cells);
+
+    // Vertical I in the right-hand well: shape column 2, rows y to y+3
+    Placement well = {SEARCH_WIDTH - 3, SEARCH_HEIGHT - 4, 1};
+    CHECK(applyPlacement(board, PIECE_I, well) == 2);
+
+    uint8_t expected[SEARCH_HEIGHT][SEARCH_WIDTH] = {};
+    expected[SEARCH_HEIGHT - 1][0] = 1;
+    expected[SEARCH_HEIGHT - 1][SEARCH_WIDTH - 1] = 1;
+    expected[SEARCH_HEIGHT - 2][SEARCH_WIDTH - 1] = 1;
+    SearchBoard reference;
+    loadSearchBoard(reference, expected);
+    CHECK(memcmp(board.rows, reference.rows, sizeof(board.rows)) == 0);
+    CHECK(board.hash == reference.hash);
+}
+
+// With a four-deep well and an I to play, the search takes the tetris
+static void checkBestMove() {
+    uint8_t cells[SEARCH_HEIGHT][SEARCH_WIDTH] = {};
+    for (int y = SEARCH_HEIGHT - 4; y < SEARCH_HEIGHT; y++) {
+        for (int x = 0; x < SEARCH_WIDTH - 1; x++) cells[y][x] = 1;
+    }
+    SearchBoard board;
+    loadSearchBoard(board, cells);
+
+    SearchMove move;
+    CHECK(findBestMove(ctx, board, PIECE_I, PIECE_O, -1, false, move));
+    CHECK(!move.hold);
+    SearchBoard after = board;
+    CHECK(applyPlacement(after, PIECE_I, move.placement) == 4);
+    CHECK(ctx.nodes > 0);
+
+    // Same board again: the follow-up boards come from the table
+    findBestMove(ctx, board, PIECE_I, PIECE_O, -1, false, move);
+    CHECK(ctx.hits > 0);
+}
+
+int main() {
+    initSearchTables();
+    initSearchContext(ctx, DEFAULT_WEIGHTS);
+    checkEmptyBoard();
+    checkTuck();
+    checkSpawnBlocked();
+    checkLineClear();
+    checkBestMove();
+    return checkResult("tetris_search_test");
+}
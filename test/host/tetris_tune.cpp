@@ -0,0 +1,138 @@
+// Autoplayer weights compared over the same seeded games: DEFAULT_WEIGHTS
+// and each weight on its own halved and raised by half. Every weight set
+// gets a thread and its own SearchContext, which is what the context is
+// for, and plays TUNE_GAMES games of at most TUNE_PIECES pieces with
+// hold, scored as the game scores lines at level 1.
+//
+//   tetris_tune [games]       TUNE_GAMES when not given (make tune GAMES=n)
+
+#include "games/game4_tetris_search.h"
+
+#include <stdlib.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#define TUNE_GAMES 4
+#define TUNE_PIECES 500
+#define TUNE_SEED 777
+
+static const int LINE_POINTS[5] = {0, 100, 300, 500, 800};
+
+struct TuneResult {
+    SearchWeights weights;
+    uint64_t score;
+    uint64_t lines;
+    uint64_t pieces;
+    int lost;              // Games that topped out before TUNE_PIECES
+    double millis;
+};
+
+static int tuneGames = TUNE_GAMES;
+
+static double hostMillis() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+// Pieces come from each game's own generator, so every weight set sees
+// the same sequences whatever thread it runs on
+static int drawPiece(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % 7;
+}
+
+static void playGame(SearchContext &ctx, int game, TuneResult &result) {
+    uint32_t state = TUNE_SEED + game * 2654435761U;
+    SearchBoard board;
+    memset(board.rows, 0, sizeof(board.rows));
+    board.hash = 0;
+
+    int current = drawPiece(state);
+    int next = drawPiece(state);
+    int held = -1;
+    for (int piece = 0; piece < TUNE_PIECES; piece++) {
+        SearchMove move;
+        if (!findBestMove(ctx, board, current, next, held, true, move)) {
+            result.lost++;
+            return;
+        }
+        // As holdPiece does: an empty hold takes the piece and the next
+        // one comes in, otherwise the two swap
+        if (move.hold) {
+            if (held < 0) {
+                held = current;
+                current = next;
+                next = drawPiece(state);
+            } else {
+                int swap = held;
+                held = current;
+                current = swap;
+            }
+        }
+        int cleared = applyPlacement(board, current, move.placement);
+        result.lines += cleared;
+        result.score += LINE_POINTS[cleared];
+        result.pieces++;
+        current = next;
+        next = drawPiece(state);
+    }
+}
+
+static void tuneWeights(TuneResult &result) {
+    double start = hostMillis();
+    SearchContext *ctx = new SearchContext;
+    initSearchContext(*ctx, result.weights);
+    for (int game = 0; game < tuneGames; game++) {
+        playGame(*ctx, game, result);
+    }
+    delete ctx;
+    result.millis = hostMillis() - start;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) tuneGames = atoi(argv[1]);
+    if (tuneGames <= 0) {
+        printf("usage: tetris_tune [games]\n");
+        return 1;
+    }
+    initSearchTables();
+
+    std::vector<TuneResult> results;
+    TuneResult base = {};
+    base.weights = DEFAULT_WEIGHTS;
+    results.push_back(base);
+    int16_t SearchWeights::*const FIELDS[] = {
+        &SearchWeights::height, &SearchWeights::holes, &SearchWeights::bumpiness,
+        &SearchWeights::lines};
+    for (int16_t SearchWeights::*field : FIELDS) {
+        for (int percent : {50, 150}) {
+            TuneResult variant = base;
+            variant.weights.*field = DEFAULT_WEIGHTS.*field * percent / 100;
+            results.push_back(variant);
+        }
+    }
+
+    double start = hostMillis();
+    std::vector<std::thread> threads;
+    for (TuneResult &result : results) {
+        threads.emplace_back(tuneWeights, std::ref(result));
+    }
+    for (std::thread &thread : threads) thread.join();
+    double elapsed = hostMillis() - start;
+
+    printf("tetris_tune: %d weight sets, %d games of up to %d pieces each, %.0f ms\n",
+           (int)results.size(), tuneGames, TUNE_PIECES, elapsed);
+    printf("  height holes bumpy lines   score/game  lines/game  lost  pieces/s\n");
+    for (const TuneResult &result : results) {
+        const SearchWeights &w = result.weights;
+        printf("  %6d %5d %5d %5d %12.0f %11.1f %5d %9.0f%s\n", w.height, w.holes,
+               w.bumpiness, w.lines, (double)result.score / tuneGames,
+               (double)result.lines / tuneGames, result.lost,
+               result.pieces * 1000.0 / result.millis, &result == &results[0] ? "  default" : "");
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// What pinball shares between cores, on real threads under
+// ThreadSanitizer: TripleBuffer between a writer and a reader, and
+// buildTableSDFRows filling disjoint rows of one field at once.
+
+#include "check.h"
+#include "shim/host.h"
+#include "engine/triple_buffer.h"
+#include "games/game2_pinball_sdf.h"
+#include <thread>
+#include <vector>
+
+#define STATES 200000
+#define SNAPSHOT_WORDS 64      // Big enough that a torn copy would show
+#define SDF_THREADS 4
+
+struct Snapshot {
+    uint32_t seq;
+    uint32_t words[SNAPSHOT_WORDS];
+};
+
+static TripleBuffer<Snapshot> buffer;
+
+// Every snapshot the reader sees is whole, and they never go backwards
+static void checkTripleBuffer() {
+    std::thread writer([] {
+        for (uint32_t seq = 1; seq <= STATES; seq++) {
+            Snapshot &s = buffer.back();
+            s.seq = seq;
+            for (int i = 0; i < SNAPSHOT_WORDS; i++) s.words[i] = seq * 31 + i;
+            buffer.publish();
+        }
+    });
+
+    uint32_t last = 0;
+    int torn = 0, backwards = 0, seen = 0;
+    while (last < STATES) {
+        if (!buffer.update()) continue;
+        const Snapshot &s = buffer.front();
+        for (int i = 0; i < SNAPSHOT_WORDS; i++) torn += s.words[i] != s.seq * 31 + i;
+        backwards += s.seq <= last;
+        last = s.seq;
+        seen++;
+    }
+    writer.join();
+
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(seen > 0);
+}
+
+static PinballTable table;
+static TableSDF serial, parallel;
+
+static void checkParallelSDF() {
+    parseTable(table, "wall 5 240 5 25\n"
+                      "wall 5 25 315 25\n"
+                      "wall 315 25 315 240\n"
+                      "seg 40 60 150 95 RED\n"
+                      "arc 160 170 30 20 160 GREEN\n"
+                      "bumper 120 120 10 RED 100\n");
+    buildTableSDF(serial, table);
+
+    std::vector<std::thread> builders;
+    int rows = (SDF_ROWS + SDF_THREADS - 1) / SDF_THREADS;
+    for (int t = 0; t < SDF_THREADS; t++) {
+        builders.emplace_back([t, rows] { buildTableSDFRows(parallel, table, t * rows, rows); });
+    }
+    for (std::thread &builder : builders) builder.join();
+
+    CHECK(memcmp(&serial, &parallel, sizeof(TableSDF)) == 0);
+}
+
+int main() {
+    checkTripleBuffer();
+    checkParallelSDF();
+    return checkResult("tsan_test");
+}
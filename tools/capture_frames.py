@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Rebuild frames from a screen capture (see src/engine/screen_capture.h).
+
+Replays the capture onto a screen and writes a PPM per frame, or one
+every --interval milliseconds of game time, into the output directory.
+Frame n is the screen as the game's nth loop pass found it. With --gif,
+and Pillow installed, writes an animated GIF instead. With --raw, writes
+the panel's own RGB565, high byte first, and an index.txt of each frame
+written: number, millis, flags and the rows read back for it.
+
+    tools/capture_frames.py Skyroads.cap frames/
+    tools/capture_frames.py Skyroads.cap skyroads.gif --gif --interval 40
+    tools/capture_frames.py Tetris.cap frames/ --raw --every 20
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"M5CAP1"
+GAP = 0x01
+STALE = 0x02
+
+# RGB565, high byte first, to RGB888: red and blue come from one byte each,
+# green from both
+RED = bytes(b & 0xF8 for b in range(256))
+GREEN_HIGH = bytes((b & 0x07) << 5 for b in range(256))
+GREEN_LOW = bytes((b >> 3) & 0x1C for b in range(256))
+BLUE = bytes((b << 3) & 0xF8 for b in range(256))
+
+
+class Screen:
+    def __init__(self, width, height):
+        self.width = width
+        self.height = height
+        self.pixels = bytearray(width * height * 2)
+        self.window = None     # x0, x1, next x, next y, bottom
+
+    def span(self, x, y, data):
+        """Pixels, two bytes each, from (x, y) along the row."""
+        if not 0 <= y < self.height:
+            return
+        if x < 0:
+            data = data[-x * 2:]
+            x = 0
+        data = data[:max(0, self.width - x) * 2]
+        i = (y * self.width + x) * 2
+        self.pixels[i:i + len(data)] = data
+
+    def stream(self, data):
+        if self.window is None:
+            return
+        x0, x1, x, y, bottom = self.window
+        while data and y <= bottom:
+            n = min(len(data) // 2, x1 - x + 1)
+            self.span(x, y, data[:n * 2])
+            data = data[n * 2:]
+            x += n
+            if x > x1:
+                x = x0
+                y += 1
+        self.window = (x0, x1, x, y, bottom)
+
+    def rgb(self):
+        high = self.pixels[0::2]
+        low = self.pixels[1::2]
+        green = (int.from_bytes(high.translate(GREEN_HIGH), "big") |
+                 int.from_bytes(low.translate(GREEN_LOW), "big"))
+        out = bytearray(len(high) * 3)
+        out[0::3] = high.translate(RED)
+        out[1::3] = green.to_bytes(len(high), "big")
+        out[2::3] = low.translate(BLUE)
+        return bytes(out)
+
+
+def read_frames(f):
+    """Yield (millis, flags, rows read back, screen) at each frame marker."""
+    if f.read(6) != MAGIC:
+        raise ValueError("not a screen capture")
+    width, height = struct.unpack("<HH", f.read(4))
+    screen = Screen(width, height)
+    rows = []
+
+    while True:
+        tag = f.read(1)
+        if not tag:
+            break
+        if tag == b"F":
+            # The marker ends the frame; the rows read back for it come first
+            millis, flags = struct.unpack("<IB", f.read(5))
+            yield millis, flags, rows, screen
+            rows = []
+        elif tag == b"R":
+            rows.append(f.read(1)[0])
+        elif tag == b"S":
+            x, y, w, color = struct.unpack("<HBHH", f.read(7))
+            screen.span(x, y, struct.pack(">H", color) * w)
+        elif tag == b"P":
+            x, y, w = struct.unpack("<HBH", f.read(5))
+            screen.span(x, y, f.read(w * 2))
+        elif tag == b"W":
+            x, y, w, h = struct.unpack("<HBHB", f.read(6))
+            screen.window = (x, x + w - 1, x, y, y + h - 1)
+        elif tag == b"D":
+            (count,) = struct.unpack("<H", f.read(2))
+            screen.stream(f.read(count * 2))
+        else:
+            raise ValueError("bad record %r at offset %d" % (tag, f.tell() - 1))
+
+
+def write_ppm(path, screen):
+    with open(path, "wb") as out:
+        out.write(b"P6\n%d %d\n255\n" % (screen.width, screen.height))
+        out.write(screen.rgb())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture")
+    parser.add_argument("output", help="directory for frames, or the GIF with --gif")
+    parser.add_argument("--interval", type=int, default=0,
+                        help="ms of game time between frames written, 0 for every frame")
+    parser.add_argument("--every", type=int, default=1,
+                        help="write only frames numbered a multiple of this")
+    parser.add_argument("--gif", action="store_true")
+    parser.add_argument("--raw", action="store_true",
+                        help="RGB565 frames and an index rather than PPMs")
+    args = parser.parse_args()
+
+    images = []
+    index = None
+    if not args.gif:
+        os.makedirs(args.output, exist_ok=True)
+        if args.raw:
+            index = open(os.path.join(args.output, "index.txt"), "w")
+
+    frames = written = gaps = stale = 0
+    next_millis = None
+    with open(args.capture, "rb") as f:
+        for millis, flags, rows, screen in read_frames(f):
+            number = frames
+            frames += 1
+            gaps += bool(flags & GAP)
+            stale += bool(flags & STALE)
+            if number % args.every != 0:
+                continue
+            if next_millis is not None and millis < next_millis:
+                continue
+            next_millis = millis + args.interval
+
+            if args.gif:
+                from PIL import Image
+                images.append(Image.frombytes("RGB", (screen.width, screen.height),
+                                              screen.rgb()))
+            elif args.raw:
+                with open(os.path.join(args.output, "frame%05d.raw" % number), "wb") as out:
+                    out.write(screen.pixels)
+                index.write("%d %d %d %s\n" % (number, millis, flags,
+                                               ",".join(map(str, rows)) or "-"))
+            else:
+                write_ppm(os.path.join(args.output, "frame%05d.ppm" % number), screen)
+            written += 1
+
+    if index:
+        index.close()
+    if args.gif and images:
+        duration = args.interval or 20
+        images[0].save(args.output, save_all=True, append_images=images[1:],
+                       duration=duration, loop=0)
+
+    print("%d of %d frames written; %d came after lost records, %d had rows still "
+          "to read back" % (written, frames, gaps, stale), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()